@@ -1,4 +1,6 @@
 #include "tioclient_internals.h"
+#include <zlib.h>
+#include <limits.h>
 //#include "tioclient.h"
 
 #define MAX_ERROR_DESCRIPTION_SIZE 255
@@ -311,26 +313,43 @@ unsigned int stream_buffer_space_left(struct STREAM_BUFFER* stream_buffer)
 	return (unsigned)(stream_buffer->buffer_size - stream_buffer_space_used(stream_buffer));
 }
 
-void stream_buffer_ensure_space_left(struct STREAM_BUFFER* stream_buffer, unsigned int size)
+//
+// returns FALSE if the buffer can't grow that much
+//
+int stream_buffer_ensure_space_left(struct STREAM_BUFFER* stream_buffer, unsigned int size)
 {
-	unsigned int new_size;
+	size_t new_size;
 	char* new_buffer;
 	unsigned int used = stream_buffer_space_used(stream_buffer);
 
 	if(stream_buffer->buffer_size - used >= size)
-		return;
+		return TRUE;
+
+	// buffer_size is 32 bits. size can come from the network
+	// (decompressed fields), so every step is checked for overflow
+	if(size > UINT_MAX - used)
+		return FALSE;
+
+	// If no room to the new data, we'll double the stream size, or raise
+	// it by (new data size) * 2 if it's not enough. Growing by a fixed
+	// amount would make building big messages (batch commands) quadratic
+	if(stream_buffer->buffer_size <= UINT_MAX / 2 && (size_t)stream_buffer->buffer_size * 2 - used >= size)
+		new_size = (size_t)stream_buffer->buffer_size * 2;
+	else if(size <= (UINT_MAX - used) / 2)
+		new_size = (size_t)used + (size_t)size * 2;
+	else
+		new_size = (size_t)used + size;
 
-	// If no room to the new data, we'll raise the the stream size by
-	// (new data size) * 2. Not sure if it's the best heuristic, but
-	// surely works
-	new_size = stream_buffer->buffer_size + (size * 2);
-	new_buffer = (char*)malloc(new_size);
-		
-	memcpy(new_buffer, stream_buffer->buffer, stream_buffer->buffer_size);
+	new_buffer = (char*)realloc(stream_buffer->buffer, new_size);
+
+	if(!new_buffer)
+		return FALSE;
 
 	stream_buffer->buffer = new_buffer;
-	stream_buffer->buffer_size = new_size;
+	stream_buffer->buffer_size = (unsigned)new_size;
 	stream_buffer->current = stream_buffer->buffer + used;
+
+	return TRUE;
 }
 
 unsigned int stream_buffer_seek(struct STREAM_BUFFER* stream_buffer, unsigned int position)
@@ -352,11 +371,14 @@ unsigned int stream_buffer_seek(struct STREAM_BUFFER* stream_buffer, unsigned in
 // struct MY_STRUCT* struct = (struct MY_STRCT*)stream_buffer_get_write_pointer(sb, sizeof(struct MY_STRUCT);
 // struct->my_int = 10;
 //
+// Returns NULL if the buffer can't grow
+//
 void* stream_buffer_get_write_pointer(struct STREAM_BUFFER* stream_buffer, unsigned int size)
 {
 	void* write_pointer;
 
-	stream_buffer_ensure_space_left(stream_buffer, size);
+	if(!stream_buffer_ensure_space_left(stream_buffer, size))
+		return NULL;
 
 	write_pointer = stream_buffer->current;
 
@@ -368,7 +390,8 @@ void* stream_buffer_get_write_pointer(struct STREAM_BUFFER* stream_buffer, unsig
 
 void stream_buffer_write(struct STREAM_BUFFER* stream_buffer, const void* buffer, unsigned int size)
 {
-	stream_buffer_ensure_space_left(stream_buffer, size);
+	if(!stream_buffer_ensure_space_left(stream_buffer, size))
+		return;
 
 	memcpy(stream_buffer->current, buffer, size);
 
@@ -402,12 +425,29 @@ void stream_buffer_delete(struct STREAM_BUFFER* message_buffer)
 
 struct PR1_MESSAGE* pr1_message_new()
 {
-	struct PR1_MESSAGE_HEADER* header;
 	struct PR1_MESSAGE* pr1_message = (struct PR1_MESSAGE*)malloc(sizeof(struct PR1_MESSAGE));
 	
 	pr1_message->stream_buffer = stream_buffer_new();
 	pr1_message->field_array = NULL;
 
+	pr1_message_reset(pr1_message);
+
+	return pr1_message;
+}
+
+//
+// makes the message empty again, keeping the stream buffer, so
+// it can be reused without new allocations
+//
+void pr1_message_reset(struct PR1_MESSAGE* pr1_message)
+{
+	struct PR1_MESSAGE_HEADER* header;
+
+	free(pr1_message->field_array);
+	pr1_message->field_array = NULL;
+
+	stream_buffer_seek(pr1_message->stream_buffer, 0);
+
 	header = (struct PR1_MESSAGE_HEADER*)stream_buffer_get_write_pointer(pr1_message->stream_buffer, sizeof(struct PR1_MESSAGE_HEADER));
 
 	// mark size on message header as invalid
@@ -415,8 +455,6 @@ struct PR1_MESSAGE* pr1_message_new()
 	header->reserved = 0;
 
 	pr1_message->field_count = 0;
-
-	return pr1_message;
 }
 
 void pr1_message_delete(struct PR1_MESSAGE* pr1_message)
@@ -549,6 +587,9 @@ const char* message_field_id_to_string(int i)
 	if(i == MESSAGE_FIELD_ID_START_RECORD) return "MESSAGE_FIELD_ID_START_RECORD";
 	if(i == MESSAGE_FIELD_ID_END) return "MESSAGE_FIELD_ID_END";
 	if(i == MESSAGE_FIELD_ID_QUERY_ID) return "MESSAGE_FIELD_ID_QUERY_ID";
+	if(i == MESSAGE_FIELD_ID_QUERY_EXPRESSION) return "MESSAGE_FIELD_ID_QUERY_EXPRESSION";
+	if(i == MESSAGE_FIELD_ID_REQUEST_ID) return "MESSAGE_FIELD_ID_REQUEST_ID";
+	if(i == MESSAGE_FIELD_ID_NO_REPLY) return "MESSAGE_FIELD_ID_NO_REPLY";
 
 	return "*UNKNOWN*";
 }
@@ -577,6 +618,9 @@ const char* tio_command_to_string(int i)
 	if(i == TIO_COMMAND_QUERY) return "TIO_COMMAND_QUERY";
 	if(i == TIO_COMMAND_WAIT_AND_POP_NEXT) return "TIO_COMMAND_WAIT_AND_POP_NEXT";
 	if(i == TIO_COMMAND_WAIT_AND_POP_KEY) return "TIO_COMMAND_WAIT_AND_POP_KEY";
+	if(i == TIO_COMMAND_PUSH_BACK_MANY) return "TIO_COMMAND_PUSH_BACK_MANY";
+	if(i == TIO_COMMAND_SET_MANY) return "TIO_COMMAND_SET_MANY";
+	if(i == TIO_COMMAND_GET_MANY) return "TIO_COMMAND_GET_MANY";
 	if(i == TIO_COMMAND_PROPGET ) return "TIO_COMMAND_PROPGET ";
 	if(i == TIO_COMMAND_PROPSET ) return "TIO_COMMAND_PROPSET ";
 
@@ -731,6 +775,13 @@ int pr1_message_receive(SOCKET socket, struct PR1_MESSAGE** pr1_message,
 
 	*pr1_message = pr1_message_new_get_buffer_for_receive(&pr1_message_header, &receive_buffer);
 
+	if(!receive_buffer)
+	{
+		pr1_message_delete(*pr1_message);
+		*pr1_message = NULL;
+		return TIO_ERROR_PROTOCOL;
+	}
+
 	result = socket_receive(
 		socket, 
 		receive_buffer,
@@ -762,6 +813,587 @@ int pr1_message_receive(SOCKET socket, struct PR1_MESSAGE** pr1_message,
 	return result;
 }
 
+//
+// PR2 protocol, see tioclient_internals.h
+//
+unsigned int pr2_varint_encode(unsigned int value, char* output)
+{
+	unsigned int size = 0;
+
+	while(value >= 0x80)
+	{
+		output[size++] = (char)((value & 0x7F) | 0x80);
+		value >>= 7;
+	}
+
+	output[size++] = (char)value;
+
+	return size;
+}
+
+//
+// returns FALSE if the varint is incomplete or invalid
+//
+int pr2_varint_decode(const char** current, const char* end, unsigned int* value)
+{
+	unsigned int shift = 0;
+	unsigned char byte;
+
+	*value = 0;
+
+	for(;;)
+	{
+		if(*current >= end || shift >= PR2_MAX_VARINT_SIZE * 7)
+			return FALSE;
+
+		byte = (unsigned char)*(*current)++;
+
+		//
+		// the fifth byte has room for the 4 bits left of an unsigned int
+		//
+		if(shift == (PR2_MAX_VARINT_SIZE - 1) * 7 && byte > 0x0F)
+			return FALSE;
+
+		*value |= (unsigned int)(byte & 0x7F) << shift;
+
+		if(!(byte & 0x80))
+			return TRUE;
+
+		shift += 7;
+	}
+}
+
+static unsigned int pr2_zigzag_encode(int value)
+{
+	return ((unsigned int)value << 1) ^ (unsigned int)(value >> 31);
+}
+
+static int pr2_zigzag_decode(unsigned int value)
+{
+	return (int)(value >> 1) ^ -(int)(value & 1);
+}
+
+static unsigned int pr2_encode_field(const struct PR1_MESSAGE_FIELD_HEADER* field, char* output)
+{
+	unsigned int size = 0;
+	unsigned short data_type = field->data_type;
+
+	if(data_type < MESSAGE_FIELD_TYPE_NONE || data_type > MESSAGE_FIELD_TYPE_COMPRESSED)
+		data_type = MESSAGE_FIELD_TYPE_STRING;
+
+	size += pr2_varint_encode(PR2_FIELD_TAG(field->field_id, data_type), output + size);
+
+	switch(data_type)
+	{
+	case MESSAGE_FIELD_TYPE_NONE:
+		break;
+	case MESSAGE_FIELD_TYPE_INT:
+		size += pr2_varint_encode(pr2_zigzag_encode(pr1_message_field_get_int(field)), output + size);
+		break;
+	case MESSAGE_FIELD_TYPE_DOUBLE:
+		memcpy(output + size, &field[1], sizeof(double));
+		size += sizeof(double);
+		break;
+	default:
+		size += pr2_varint_encode(field->data_size, output + size);
+		memcpy(output + size, &field[1], field->data_size);
+		size += field->data_size;
+		break;
+	}
+
+	return size;
+}
+
+//
+// output must have pr1_fields_size bytes, PR2 is never bigger than PR1
+//
+unsigned int pr2_encode_fields(const void* pr1_fields, unsigned int pr1_fields_size, char* output)
+{
+	const char* current = (const char*)pr1_fields;
+	const char* end = current + pr1_fields_size;
+	const struct PR1_MESSAGE_FIELD_HEADER* field;
+	unsigned int size = 0;
+
+	while(current < end)
+	{
+		field = (const struct PR1_MESSAGE_FIELD_HEADER*)current;
+		size += pr2_encode_field(field, output + size);
+		current += sizeof(struct PR1_MESSAGE_FIELD_HEADER) + field->data_size;
+	}
+
+	return size;
+}
+
+//
+// Encodes a complete PR1 message, including the size prefix. output must have
+// the size of the PR1 message (header included). Returns the PR2 message size
+//
+unsigned int pr2_encode_message(const void* pr1_buffer, char* output)
+{
+	const struct PR1_MESSAGE_HEADER* header = (const struct PR1_MESSAGE_HEADER*)pr1_buffer;
+	const char* fields = (const char*)&header[1];
+	const char* end = fields + header->message_size;
+	const char* current;
+	const struct PR1_MESSAGE_FIELD_HEADER* field;
+	const struct PR1_MESSAGE_FIELD_HEADER* command_field = NULL;
+	const struct PR1_MESSAGE_FIELD_HEADER* handle_field = NULL;
+	const struct PR1_MESSAGE_FIELD_HEADER* event_field = NULL;
+	char* body = output + PR2_MAX_VARINT_SIZE;
+	unsigned int body_size = 0, prefix_size;
+	int command;
+
+	for(current = fields ; current < end ; current += sizeof(struct PR1_MESSAGE_FIELD_HEADER) + field->data_size)
+	{
+		field = (const struct PR1_MESSAGE_FIELD_HEADER*)current;
+
+		if(field->data_type != MESSAGE_FIELD_TYPE_INT)
+			continue;
+
+		if(field->field_id == MESSAGE_FIELD_ID_COMMAND && !command_field)
+			command_field = field;
+		else if(field->field_id == MESSAGE_FIELD_ID_HANDLE && !handle_field)
+			handle_field = field;
+		else if(field->field_id == MESSAGE_FIELD_ID_EVENT && !event_field)
+			event_field = field;
+	}
+
+	command = command_field ? pr1_message_field_get_int(command_field) : 0;
+
+	body_size += pr2_varint_encode((unsigned int)command, body + body_size);
+
+	if(command == TIO_COMMAND_EVENT)
+	{
+		body_size += pr2_varint_encode(handle_field ? (unsigned int)pr1_message_field_get_int(handle_field) : 0, body + body_size);
+		body_size += pr2_varint_encode(event_field ? (unsigned int)pr1_message_field_get_int(event_field) : 0, body + body_size);
+	}
+	else
+	{
+		handle_field = NULL;
+		event_field = NULL;
+	}
+
+	for(current = fields ; current < end ; current += sizeof(struct PR1_MESSAGE_FIELD_HEADER) + field->data_size)
+	{
+		field = (const struct PR1_MESSAGE_FIELD_HEADER*)current;
+
+		if(field == command_field || field == handle_field || field == event_field)
+			continue;
+
+		body_size += pr2_encode_field(field, body + body_size);
+	}
+
+	prefix_size = pr2_varint_encode(body_size, output);
+
+	memmove(output + prefix_size, body, body_size);
+
+	return prefix_size + body_size;
+}
+
+//
+// Returns the size of the size prefix, zero if we need more data to read
+// it or TIO_ERROR_PROTOCOL if it's invalid
+//
+int pr2_read_message_size(const void* buffer, unsigned int buffer_size, unsigned int* body_size)
+{
+	const char* current = (const char*)buffer;
+	const char* end = current + buffer_size;
+
+	if(pr2_varint_decode(&current, end, body_size))
+		return (int)(current - (const char*)buffer);
+
+	if(buffer_size >= PR2_MAX_VARINT_SIZE)
+		return TIO_ERROR_PROTOCOL;
+
+	return 0;
+}
+
+//
+// Decodes the body of a PR2 message as fields of pr1_message
+//
+int pr2_decode_message(const void* body, unsigned int body_size, struct PR1_MESSAGE* pr1_message)
+{
+	const char* current = (const char*)body;
+	const char* end = current + body_size;
+	unsigned int value, field_id, data_type;
+	double double_value;
+
+	if(!pr2_varint_decode(&current, end, &value))
+		return TIO_ERROR_PROTOCOL;
+
+	pr1_message_add_field_int(pr1_message, MESSAGE_FIELD_ID_COMMAND, (int)value);
+
+	if(value == TIO_COMMAND_EVENT)
+	{
+		if(!pr2_varint_decode(&current, end, &value))
+			return TIO_ERROR_PROTOCOL;
+
+		pr1_message_add_field_int(pr1_message, MESSAGE_FIELD_ID_HANDLE, (int)value);
+
+		if(!pr2_varint_decode(&current, end, &value))
+			return TIO_ERROR_PROTOCOL;
+
+		pr1_message_add_field_int(pr1_message, MESSAGE_FIELD_ID_EVENT, (int)value);
+	}
+
+	while(current < end)
+	{
+		if(!pr2_varint_decode(&current, end, &value) || (value >> 3) > 0xFFFF)
+			return TIO_ERROR_PROTOCOL;
+
+		field_id = value >> 3;
+		data_type = (value & 0x7) + 1;
+
+		if(data_type > MESSAGE_FIELD_TYPE_COMPRESSED)
+			return TIO_ERROR_PROTOCOL;
+
+		switch(data_type)
+		{
+		case MESSAGE_FIELD_TYPE_NONE:
+			pr1_message_add_field(pr1_message, (unsigned short)field_id, MESSAGE_FIELD_TYPE_NONE, NULL, 0);
+			break;
+		case MESSAGE_FIELD_TYPE_INT:
+			if(!pr2_varint_decode(&current, end, &value))
+				return TIO_ERROR_PROTOCOL;
+
+			pr1_message_add_field_int(pr1_message, (unsigned short)field_id, pr2_zigzag_decode(value));
+			break;
+		case MESSAGE_FIELD_TYPE_DOUBLE:
+			if(end - current < (int)sizeof(double))
+				return TIO_ERROR_PROTOCOL;
+
+			memcpy(&double_value, current, sizeof(double));
+			current += sizeof(double);
+
+			pr1_message_add_field_double(pr1_message, (unsigned short)field_id, double_value);
+			break;
+		default:
+			if(!pr2_varint_decode(&current, end, &value) || (unsigned int)(end - current) < value)
+				return TIO_ERROR_PROTOCOL;
+
+			pr1_message_add_field(pr1_message, (unsigned short)field_id, (unsigned short)data_type, current, value);
+			current += value;
+			break;
+		}
+	}
+
+	pr1_message_fill_header_info(pr1_message);
+
+	return TIO_SUCCESS;
+}
+
+//
+// Field compression, for compressed connections. Strings bigger than
+// the threshold are sent as MESSAGE_FIELD_TYPE_COMPRESSED
+//
+int pr1_compress_fields(const void* pr1_buffer, unsigned int threshold, struct PR1_MESSAGE* pr1_message)
+{
+	const struct PR1_MESSAGE_HEADER* header = (const struct PR1_MESSAGE_HEADER*)pr1_buffer;
+	const char* fields = (const char*)&header[1];
+	const char* end = fields + header->message_size;
+	const char* current;
+	const struct PR1_MESSAGE_FIELD_HEADER* field;
+	struct PR1_MESSAGE_FIELD_HEADER* compressed_field;
+	unsigned int original_size;
+	uLongf compressed_size;
+	char* output;
+	int compressed_count = 0;
+
+	for(current = fields ; current < end ; current += sizeof(struct PR1_MESSAGE_FIELD_HEADER) + field->data_size)
+	{
+		field = (const struct PR1_MESSAGE_FIELD_HEADER*)current;
+
+		if(field->data_type == MESSAGE_FIELD_TYPE_STRING && field->data_size >= threshold)
+			break;
+	}
+
+	if(current >= end)
+		return 0;
+
+	for(current = fields ; current < end ; current += sizeof(struct PR1_MESSAGE_FIELD_HEADER) + field->data_size)
+	{
+		field = (const struct PR1_MESSAGE_FIELD_HEADER*)current;
+
+		if(field->data_type != MESSAGE_FIELD_TYPE_STRING || field->data_size < threshold)
+		{
+			pr1_message_add_field(pr1_message, field->field_id, field->data_type, &field[1], field->data_size);
+			continue;
+		}
+
+		//
+		// we write the compressed data straight to the message stream buffer
+		// and give back what we didn't use
+		//
+		compressed_size = compressBound(field->data_size);
+
+		compressed_field = (struct PR1_MESSAGE_FIELD_HEADER*)stream_buffer_get_write_pointer(pr1_message->stream_buffer, 
+			sizeof(struct PR1_MESSAGE_FIELD_HEADER) + sizeof(original_size) + compressed_size);
+
+		output = (char*)&compressed_field[1];
+
+		if(compress2((Bytef*)output + sizeof(original_size), &compressed_size, (const Bytef*)&field[1], field->data_size, Z_BEST_SPEED) != Z_OK ||
+			compressed_size + sizeof(original_size) >= field->data_size)
+		{
+			stream_buffer_seek(pr1_message->stream_buffer, (unsigned int)((char*)compressed_field - pr1_message->stream_buffer->buffer));
+			pr1_message_add_field(pr1_message, field->field_id, field->data_type, &field[1], field->data_size);
+			continue;
+		}
+
+		original_size = field->data_size;
+		memcpy(output, &original_size, sizeof(original_size));
+
+		compressed_field->field_id = field->field_id;
+		compressed_field->data_type = MESSAGE_FIELD_TYPE_COMPRESSED;
+		compressed_field->data_size = (unsigned int)(sizeof(original_size) + compressed_size);
+
+		stream_buffer_seek(pr1_message->stream_buffer, 
+			(unsigned int)(output + compressed_field->data_size - pr1_message->stream_buffer->buffer));
+
+		pr1_message->field_count++;
+		compressed_count++;
+	}
+
+	pr1_message_fill_header_info(pr1_message);
+
+	return compressed_count;
+}
+
+int pr1_decompress_fields(const void* pr1_buffer, struct PR1_MESSAGE* pr1_message)
+{
+	const struct PR1_MESSAGE_HEADER* header = (const struct PR1_MESSAGE_HEADER*)pr1_buffer;
+	const char* fields = (const char*)&header[1];
+	const char* end = fields + header->message_size;
+	const char* current;
+	const struct PR1_MESSAGE_FIELD_HEADER* field;
+	unsigned int original_size, compressed_size, total_size = 0;
+	uLongf decompressed_size;
+	void* output;
+	int decompressed_count = 0;
+
+	for(current = fields ; current < end ; current += sizeof(struct PR1_MESSAGE_FIELD_HEADER) + field->data_size)
+	{
+		field = (const struct PR1_MESSAGE_FIELD_HEADER*)current;
+
+		if((unsigned int)(end - current) < sizeof(struct PR1_MESSAGE_FIELD_HEADER) ||
+			(unsigned int)(end - current) - sizeof(struct PR1_MESSAGE_FIELD_HEADER) < field->data_size)
+			return TIO_ERROR_PROTOCOL;
+
+		if(field->data_type == MESSAGE_FIELD_TYPE_COMPRESSED)
+			decompressed_count++;
+	}
+
+	if(decompressed_count == 0)
+		return 0;
+
+	decompressed_count = 0;
+
+	for(current = fields ; current < end ; current += sizeof(struct PR1_MESSAGE_FIELD_HEADER) + field->data_size)
+	{
+		field = (const struct PR1_MESSAGE_FIELD_HEADER*)current;
+
+		if(field->data_type != MESSAGE_FIELD_TYPE_COMPRESSED)
+		{
+			pr1_message_add_field(pr1_message, field->field_id, field->data_type, &field[1], field->data_size);
+			continue;
+		}
+
+		if(field->data_size < sizeof(original_size))
+			return TIO_ERROR_PROTOCOL;
+
+		memcpy(&original_size, &field[1], sizeof(original_size));
+		compressed_size = field->data_size - sizeof(original_size);
+
+		if(original_size / PR1_MAX_COMPRESSION_RATIO > compressed_size ||
+			original_size > PR1_MAX_DECOMPRESSED_SIZE - total_size)
+			return TIO_ERROR_PROTOCOL;
+
+		total_size += original_size;
+
+		pr1_message_add_field(pr1_message, field->field_id, MESSAGE_FIELD_TYPE_STRING, NULL, 0);
+
+		output = stream_buffer_get_write_pointer(pr1_message->stream_buffer, original_size);
+
+		if(!output)
+			return TIO_ERROR_GENERIC;
+
+		decompressed_size = original_size;
+
+		if(uncompress((Bytef*)output, &decompressed_size, 
+				(const Bytef*)&field[1] + sizeof(original_size), compressed_size) != Z_OK ||
+			decompressed_size != original_size)
+		{
+			return TIO_ERROR_PROTOCOL;
+		}
+
+		//
+		// the field was added empty, now it has the data
+		//
+		((struct PR1_MESSAGE_FIELD_HEADER*)((char*)output - sizeof(struct PR1_MESSAGE_FIELD_HEADER)))->data_size = original_size;
+
+		decompressed_count++;
+	}
+
+	pr1_message_fill_header_info(pr1_message);
+
+	return decompressed_count;
+}
+
+int tio_message_send_and_delete(struct TIO_CONNECTION* connection, struct PR1_MESSAGE* pr1_message)
+{
+	void* buffer;
+	unsigned int size;
+	char* pr2_buffer;
+	int result;
+	struct PR1_MESSAGE* compressed_message;
+
+	if(connection->compression_threshold)
+	{
+		compressed_message = pr1_message_new();
+
+		pr1_message_get_buffer(pr1_message, &buffer, &size);
+
+		if(pr1_compress_fields(buffer, connection->compression_threshold, compressed_message) > 0)
+		{
+			pr1_message_delete(pr1_message);
+			pr1_message = compressed_message;
+		}
+		else
+			pr1_message_delete(compressed_message);
+	}
+
+	if(connection->protocol != TIO_PROTOCOL_COMPACT)
+		return pr1_message_send_and_delete(connection->socket, pr1_message);
+
+	pr1_message_get_buffer(pr1_message, &buffer, &size);
+
+	dump_pr1_message("SEND", pr1_message);
+
+	pr2_buffer = (char*)malloc(size);
+
+	size = pr2_encode_message(buffer, pr2_buffer);
+
+	result = socket_send(connection->socket, pr2_buffer, size);
+
+	free(pr2_buffer);
+	pr1_message_delete(pr1_message);
+
+	return result;
+}
+
+int pr2_message_receive(struct TIO_CONNECTION* connection, struct PR1_MESSAGE** pr1_message,
+	const unsigned* message_header_timeout_in_seconds, const unsigned* message_payload_timeout_in_seconds)
+{
+	int result;
+	char prefix[PR2_MAX_VARINT_SIZE];
+	unsigned int prefix_size = 0, body_size;
+	char* body;
+
+	*pr1_message = NULL;
+
+	//
+	// the size prefix has 1 to 5 bytes. Small messages have a 1 byte prefix, so
+	// we read byte by byte instead of keeping a receive buffer
+	//
+	do
+	{
+		result = socket_receive(connection->socket, &prefix[prefix_size], 1, 
+			prefix_size == 0 ? message_header_timeout_in_seconds : message_payload_timeout_in_seconds);
+
+		if(TIO_FAILED(result))
+			return result;
+
+		if(result < 1)
+			return TIO_ERROR_NETWORK;
+
+		prefix_size++;
+
+		result = pr2_read_message_size(prefix, prefix_size, &body_size);
+
+		if(TIO_FAILED(result))
+			return result;
+	}
+	while(result == 0);
+
+	body = (char*)malloc(body_size ? body_size : 1);
+
+	result = socket_receive(connection->socket, body, body_size, message_payload_timeout_in_seconds);
+
+	if(TIO_FAILED(result) || (unsigned)result < body_size)
+	{
+		free(body);
+		return TIO_FAILED(result) ? result : TIO_ERROR_NETWORK;
+	}
+
+	*pr1_message = pr1_message_new();
+
+	result = pr2_decode_message(body, body_size, *pr1_message);
+
+	free(body);
+
+	if(TIO_FAILED(result))
+	{
+		pr1_message_delete(*pr1_message);
+		*pr1_message = NULL;
+		return result;
+	}
+
+	pr1_message_parse(*pr1_message);
+
+	dump_pr1_message("RCEV", *pr1_message);
+
+	return prefix_size + body_size;
+}
+
+//
+// replaces the received message by one with the compressed fields
+// expanded, if there's any
+//
+int tio_message_decompress(struct PR1_MESSAGE** pr1_message, int received_size)
+{
+	void* buffer;
+	unsigned int size;
+	int result;
+	struct PR1_MESSAGE* decompressed_message = pr1_message_new();
+
+	pr1_message_get_buffer(*pr1_message, &buffer, &size);
+
+	result = pr1_decompress_fields(buffer, decompressed_message);
+
+	if(result <= 0)
+	{
+		pr1_message_delete(decompressed_message);
+
+		if(!TIO_FAILED(result))
+			return received_size;
+
+		pr1_message_delete(*pr1_message);
+		*pr1_message = NULL;
+		return result;
+	}
+
+	pr1_message_delete(*pr1_message);
+	*pr1_message = decompressed_message;
+
+	pr1_message_parse(*pr1_message);
+
+	return received_size;
+}
+
+int tio_message_receive(struct TIO_CONNECTION* connection, struct PR1_MESSAGE** pr1_message,
+	const unsigned* message_header_timeout_in_seconds, const unsigned* message_payload_timeout_in_seconds)
+{
+	int result;
+
+	if(connection->protocol != TIO_PROTOCOL_COMPACT)
+		result = pr1_message_receive(connection->socket, pr1_message, message_header_timeout_in_seconds, message_payload_timeout_in_seconds);
+	else
+		result = pr2_message_receive(connection, pr1_message, message_header_timeout_in_seconds, message_payload_timeout_in_seconds);
+
+	if(TIO_FAILED(result) || !connection->compression_threshold || !*pr1_message)
+		return result;
+
+	return tio_message_decompress(pr1_message, result);
+}
+
 /*
 int pr1_message_receive_if_available(SOCKET socket, struct PR1_MESSAGE** pr1_message)
 {
@@ -779,6 +1411,13 @@ int pr1_message_receive_if_available(SOCKET socket, struct PR1_MESSAGE** pr1_mes
 
 	*pr1_message = pr1_message_new_get_buffer_for_receive(&pr1_message_header, &receive_buffer);
 
+	if(!receive_buffer)
+	{
+		pr1_message_delete(*pr1_message);
+		*pr1_message = NULL;
+		return TIO_ERROR_PROTOCOL;
+	}
+
 	result = socket_receive(
 		socket, 
 		receive_buffer,
@@ -1021,12 +1660,38 @@ void check_not_on_network_batch(struct TIO_CONNECTION* connection)
 
 
 int tio_connect(const char* host, short port, struct TIO_CONNECTION** connection)
+{
+	return tio_connect_ex(host, port, TIO_PROTOCOL_BINARY, connection);
+}
+
+int tio_connect_ex(const char* host, short port, int protocol, struct TIO_CONNECTION** connection)
 {
 	SOCKET sockfd;
 	struct sockaddr_in serv_addr;
 	struct hostent *server = NULL;
 	int result;
-	char buffer[sizeof("going binary") -1];
+	char buffer[sizeof("going compact") -1];
+	const char* protocol_command = "protocol binary\r\n";
+	const char* protocol_answer = "going binary";
+	int compressed = (protocol & TIO_PROTOCOL_COMPRESSED) != 0;
+
+	protocol &= ~TIO_PROTOCOL_COMPRESSED;
+
+	if(protocol == TIO_PROTOCOL_COMPACT)
+	{
+		protocol_command = compressed ? "protocol compact compressed\r\n" : "protocol compact\r\n";
+		protocol_answer = "going compact";
+	}
+	else if(protocol == TIO_PROTOCOL_BINARY)
+	{
+		if(compressed)
+			protocol_command = "protocol binary compressed\r\n";
+	}
+	else
+	{
+		pr1_set_last_error_description("Invalid protocol");
+		return TIO_ERROR_PROTOCOL;
+	}
 
 	if(!g_initialized)
 		tio_initialize();
@@ -1057,7 +1722,7 @@ int tio_connect(const char* host, short port, struct TIO_CONNECTION** connection
 		return TIO_ERROR_NETWORK;
 	}
 
-	result = socket_send(sockfd, "protocol binary\r\n", sizeof("protocol binary\r\n") -1);
+	result = socket_send(sockfd, protocol_command, strlen32(protocol_command));
 	if(TIO_FAILED(result)) 
 	{
 		pr1_set_last_error_description("Error sending data to server during protocol negotiation");
@@ -1065,7 +1730,7 @@ int tio_connect(const char* host, short port, struct TIO_CONNECTION** connection
 		return result;
 	}
 
-	result = socket_receive(sockfd, buffer, sizeof(buffer), NULL);
+	result = socket_receive(sockfd, buffer, strlen32(protocol_answer), NULL);
 	if(TIO_FAILED(result)) 
 	{
 		pr1_set_last_error_description("Error receiving data to server during protocol negotiation");
@@ -1074,22 +1739,26 @@ int tio_connect(const char* host, short port, struct TIO_CONNECTION** connection
 	}
 
 	// invalid answer
-	if(memcmp(buffer, "going binary", sizeof("going binary")-1) !=0)
+	if(memcmp(buffer, protocol_answer, strlen32(protocol_answer)) !=0)
 	{
 		pr1_set_last_error_description("Invalid answer from server during protocol negotiation");
 		closesocket(sockfd);
 		return TIO_ERROR_PROTOCOL;
 	}
 
-#ifdef _WIN32
+	//
+	// no-reply writes are sent back to back with the next request,
+	// that can't wait for the ack of the write
+	//
 	result = 1;
 	setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&result, 4);
-#endif
 
 	*connection = (struct TIO_CONNECTION*)malloc(sizeof(struct TIO_CONNECTION));
 	(*connection)->socket = sockfd;
 	(*connection)->host = duplicate_string(host);
 	(*connection)->port = port;
+	(*connection)->protocol = protocol;
+	(*connection)->compression_threshold = compressed ? TIO_DEFAULT_COMPRESSION_THRESHOLD : 0;
 	(*connection)->event_list_queue_end = NULL;
 	(*connection)->containers_count = 64; // initial buffer size
 	(*connection)->containers = malloc(sizeof(void*) * (*connection)->containers_count);
@@ -1104,6 +1773,9 @@ int tio_connect(const char* host, short port, struct TIO_CONNECTION** connection
 	(*connection)->pending_event_count = 0;
 	(*connection)->max_pending_event_count = 0;
 	(*connection)->pending_answer_count = 0;
+	(*connection)->no_reply = FALSE;
+	(*connection)->error_callback = NULL;
+	(*connection)->error_cookie = NULL;
 	(*connection)->debug_flags = 0;
 
 	return TIO_SUCCESS;
@@ -1208,9 +1880,30 @@ struct PR1_MESSAGE* tio_generate_data_message(unsigned int command_id, int handl
 	return pr1_message;
 }
 
+int is_no_reply_command(struct TIO_CONNECTION* connection, unsigned int command_id)
+{
+	if(!connection->no_reply)
+		return FALSE;
+
+	switch(command_id)
+	{
+	case TIO_COMMAND_PUSH_BACK:
+	case TIO_COMMAND_PUSH_FRONT:
+	case TIO_COMMAND_SET:
+	case TIO_COMMAND_INSERT:
+	case TIO_COMMAND_DELETE:
+	case TIO_COMMAND_CLEAR:
+	case TIO_COMMAND_PROPSET:
+	case TIO_COMMAND_PUSH_BACK_MANY:
+	case TIO_COMMAND_SET_MANY:
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
 int tio_container_send_command(struct TIO_CONTAINER* container, unsigned int command_id, const struct TIO_DATA* key, const struct TIO_DATA* value, const struct TIO_DATA* metadata)
 {
-	SOCKET socket = container->connection->socket;
 	int result;
 
 	struct PR1_MESSAGE* pr1_message = 
@@ -1218,7 +1911,10 @@ int tio_container_send_command(struct TIO_CONTAINER* container, unsigned int com
 
 	check_correct_thread(container->connection);
 
-	result = pr1_message_send_and_delete(socket, pr1_message);
+	if(is_no_reply_command(container->connection, command_id))
+		pr1_message_add_field_int(pr1_message, MESSAGE_FIELD_ID_NO_REPLY, TRUE);
+
+	result = tio_message_send_and_delete(container->connection, pr1_message);
 
 	return result;
 }
@@ -1334,7 +2030,6 @@ int tio_receive_message(struct TIO_CONNECTION* connection, unsigned int* command
 {
 	int result;
 	unsigned int a;
-	SOCKET socket = connection->socket;
 	const struct PR1_MESSAGE_FIELD_HEADER* current_field;
 
 	struct PR1_MESSAGE* pr1_message;
@@ -1342,7 +2037,7 @@ int tio_receive_message(struct TIO_CONNECTION* connection, unsigned int* command
 	check_correct_thread(connection);
 	check_not_on_network_batch(connection);
 
-	result = pr1_message_receive(socket, &pr1_message, NULL, NULL);
+	result = tio_message_receive(connection, &pr1_message, NULL, NULL);
 
 	connection->total_messages_received++;
 	
@@ -1489,7 +2184,7 @@ int tio_receive_next_pending_event(struct TIO_CONNECTION* connection, const unsi
 	// In some weird situation (like server sending just the message headed and hanging right
 	// after that) we can wait for twice the timeout value. I don't think it's an issue...
 	//
-	result = pr1_message_receive(connection->socket, &received_message, timeout_in_seconds, timeout_in_seconds);
+	result = tio_message_receive(connection, &received_message, timeout_in_seconds, timeout_in_seconds);
 
 	if(TIO_FAILED(result))
 		return result;
@@ -1539,7 +2234,7 @@ int tio_receive_until_not_event(struct TIO_CONNECTION* connection, struct PR1_ME
 	// we'll loop until we receive a response (anything that is not an event)
 	for(;;)
 	{
-		result = pr1_message_receive(connection->socket, &received_message, NULL, NULL);
+		result = tio_message_receive(connection, &received_message, NULL, NULL);
 		
 		if(TIO_FAILED(result))
 			return result;
@@ -1668,13 +2363,12 @@ int tio_create_or_open(struct TIO_CONNECTION* connection, unsigned int command_i
 	struct PR1_MESSAGE* pr1_message = NULL;
 	struct PR1_MESSAGE* response = NULL;
 	int result;
-	SOCKET socket = connection->socket;
 
 	*container = NULL;
 
 	pr1_message = tio_generate_create_or_open_msg(command_id, name, type);
 
-	pr1_message_send_and_delete(socket, pr1_message);
+	tio_message_send_and_delete(connection, pr1_message);
 
 	//receive
 	result = tio_receive_until_not_event(connection, &response);
@@ -1723,7 +2417,7 @@ int tio_close(struct TIO_CONTAINER* container)
 	pr1_message_add_field_int(request, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_CLOSE);
 	pr1_message_add_field_int(request, MESSAGE_FIELD_ID_HANDLE, handle);
 
-	result = pr1_message_send_and_delete(container->connection->socket, request);
+	result = tio_message_send_and_delete(container->connection, request);
 	if(TIO_FAILED(result)) 
 		goto clean_up_and_return;
 
@@ -1773,7 +2467,35 @@ int tio_dispatch_pending_events(struct TIO_CONNECTION* connection, unsigned int
 		handle_field = pr1_message_field_find_by_id(event_message, MESSAGE_FIELD_ID_HANDLE);
 		event_code_field = pr1_message_field_find_by_id(event_message, MESSAGE_FIELD_ID_EVENT);
 
-		if(handle_field &&
+		if(event_code_field &&
+			event_code_field->data_type == TIO_DATA_TYPE_INT &&
+			pr1_message_field_get_int(event_code_field) == TIO_EVENT_ERROR)
+		{
+			//
+			// error of a no-reply write. The handle can be invalid, that
+			// can be the error itself
+			//
+			container = NULL;
+
+			if(handle_field && handle_field->data_type == TIO_DATA_TYPE_INT)
+			{
+				handle = pr1_message_field_get_int(handle_field);
+
+				if(handle >= 0 && handle < connection->containers_count)
+					container = connection->containers[handle];
+			}
+
+			tiodata_set_as_none(&key);
+			tiodata_set_as_none(&metadata);
+			pr1_message_field_to_tio_data(pr1_message_field_find_by_id(event_message, MESSAGE_FIELD_ID_ERROR_DESC), &value);
+
+			if(connection->error_callback)
+				connection->error_callback(pr1_message_get_error_code(event_message), container, connection->error_cookie, TIO_EVENT_ERROR, 
+					container ? container->group_name : NULL, container ? container->name : NULL, &key, &value, &metadata);
+
+			tiodata_set_as_none(&value);
+		}
+		else if(handle_field &&
 			handle_field->data_type == TIO_DATA_TYPE_INT &&
 			event_code_field &&
 			event_code_field->data_type == TIO_DATA_TYPE_INT)
@@ -1829,7 +2551,6 @@ int tio_ping(struct TIO_CONNECTION* connection, char* payload)
 	struct PR1_MESSAGE_FIELD_HEADER* value_field = NULL;
 	int result;
 	unsigned int payload_len;
-	SOCKET socket = connection->socket;
 
 	payload_len = strlen32(payload);
 
@@ -1838,7 +2559,7 @@ int tio_ping(struct TIO_CONNECTION* connection, char* payload)
 	pr1_message_add_field_int(pr1_message, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_PING);
 	pr1_message_add_field_string(pr1_message, MESSAGE_FIELD_ID_VALUE, payload);
 
-	pr1_message_send_and_delete(socket, pr1_message);
+	tio_message_send_and_delete(connection, pr1_message);
 
 	//receive
 	result = tio_receive_until_not_event(connection, &response);
@@ -1881,7 +2602,11 @@ int tio_container_input_command(struct TIO_CONTAINER* container, unsigned short
 	struct PR1_MESSAGE* response = NULL;
 	int result;
 
-	if(container->connection->wait_for_answer)
+	if(is_no_reply_command(container->connection, command_id))
+	{
+		result = tio_container_send_command(container, command_id, key, value, metadata);
+	}
+	else if(container->connection->wait_for_answer)
 	{
 		result = tio_container_send_command_and_get_response(container, command_id, key, value, metadata, &response);
 
@@ -1978,6 +2703,224 @@ int tio_container_get(struct TIO_CONTAINER* container, const struct TIO_DATA* se
 		metadata);
 }
 
+struct PR1_MESSAGE* tio_generate_many_message(unsigned int command_id, int handle, unsigned int count, 
+	const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)
+{
+	unsigned int a;
+	struct PR1_MESSAGE* pr1_message = pr1_message_new();
+
+	pr1_message_add_field_int(pr1_message, MESSAGE_FIELD_ID_COMMAND, command_id);
+	pr1_message_add_field_int(pr1_message, MESSAGE_FIELD_ID_HANDLE, handle);
+
+	for(a = 0 ; a < count ; a++)
+	{
+		if(keys)
+			tio_data_add_to_pr1_message(pr1_message, MESSAGE_FIELD_ID_KEY, &keys[a]);
+		if(values)
+			tio_data_add_to_pr1_message(pr1_message, MESSAGE_FIELD_ID_VALUE, &values[a]);
+		if(metadatas)
+			tio_data_add_to_pr1_message(pr1_message, MESSAGE_FIELD_ID_METADATA, &metadatas[a]);
+	}
+
+	return pr1_message;
+}
+
+//
+// Sends all the messages before waiting for the first answer, so we
+// don't pay a round trip per message
+//
+int tio_container_send_many_messages(struct TIO_CONTAINER* container, unsigned int command_id, unsigned int count, 
+	const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas, unsigned int* message_count)
+{
+	int result;
+	unsigned int sent, items;
+	struct PR1_MESSAGE* pr1_message;
+
+	check_correct_thread(container->connection);
+
+	*message_count = 0;
+
+	for(sent = 0 ; sent < count ; sent += items)
+	{
+		items = count - sent;
+
+		if(items > TIO_MAX_RECORDS_PER_MESSAGE)
+			items = TIO_MAX_RECORDS_PER_MESSAGE;
+
+		pr1_message = tio_generate_many_message(
+			command_id, 
+			container->handle, 
+			items, 
+			keys ? &keys[sent] : NULL,
+			values ? &values[sent] : NULL,
+			metadatas ? &metadatas[sent] : NULL);
+
+		if(is_no_reply_command(container->connection, command_id))
+			pr1_message_add_field_int(pr1_message, MESSAGE_FIELD_ID_NO_REPLY, TRUE);
+
+		result = tio_message_send_and_delete(container->connection, pr1_message);
+
+		if(TIO_FAILED(result))
+			return result;
+
+		(*message_count)++;
+	}
+
+	return TIO_SUCCESS;
+}
+
+int tio_container_input_many_command(struct TIO_CONTAINER* container, unsigned int command_id, unsigned int count, 
+	const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)
+{
+	struct PR1_MESSAGE* response = NULL;
+	unsigned int a, message_count;
+	int result, error;
+
+	result = tio_container_send_many_messages(container, command_id, count, keys, values, metadatas, &message_count);
+
+	if(is_no_reply_command(container->connection, command_id))
+		return result;
+
+	if(!container->connection->wait_for_answer)
+	{
+		container->connection->pending_event_count += message_count;
+		return result;
+	}
+
+	//
+	// we must read all the answers even if some failed, to
+	// keep the connection in sync
+	//
+	for(a = 0 ; a < message_count ; a++)
+	{
+		error = tio_receive_until_not_event(container->connection, &response);
+
+		if(!TIO_FAILED(error))
+		{
+			error = pr1_message_get_error_code(response);
+			pr1_message_delete(response);
+			response = NULL;
+		}
+
+		if(TIO_FAILED(error) && !TIO_FAILED(result))
+			result = error;
+	}
+
+	return TIO_FAILED(result) ? result : TIO_SUCCESS;
+}
+
+int tio_container_push_back_many(struct TIO_CONTAINER* container, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)
+{
+	if(!values)
+		return TIO_ERROR_MISSING_PARAMETER;
+
+	return tio_container_input_many_command(container, TIO_COMMAND_PUSH_BACK_MANY, count, keys, values, metadatas);
+}
+
+int tio_container_set_many(struct TIO_CONTAINER* container, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)
+{
+	if(!keys || !values)
+		return TIO_ERROR_MISSING_PARAMETER;
+
+	return tio_container_input_many_command(container, TIO_COMMAND_SET_MANY, count, keys, values, metadatas);
+}
+
+int tio_container_get_many(struct TIO_CONTAINER* container, unsigned int count, const struct TIO_DATA* search_keys, 
+	struct TIO_DATA* keys, struct TIO_DATA* values, struct TIO_DATA* metadatas, int* results)
+{
+	struct PR1_MESSAGE* response = NULL;
+	const struct PR1_MESSAGE_FIELD_HEADER* field;
+	unsigned int a, b, message_count, received = 0;
+	int result, error, current;
+
+	BOOL inside_network_batch = !container->connection->wait_for_answer;
+
+	if(!search_keys)
+		return TIO_ERROR_MISSING_PARAMETER;
+
+	if (inside_network_batch)
+		tio_finish_network_batch(container->connection);
+
+	for(a = 0 ; a < count ; a++)
+	{
+		if(keys) tiodata_set_as_none(&keys[a]);
+		if(values) tiodata_set_as_none(&values[a]);
+		if(metadatas) tiodata_set_as_none(&metadatas[a]);
+		if(results) results[a] = TIO_ERROR_NO_SUCH_OBJECT;
+	}
+
+	result = tio_container_send_many_messages(container, TIO_COMMAND_GET_MANY, count, search_keys, NULL, NULL, &message_count);
+
+	for(a = 0 ; a < message_count ; a++)
+	{
+		error = tio_receive_until_not_event(container->connection, &response);
+
+		if(TIO_FAILED(error))
+		{
+			result = error;
+			break;
+		}
+
+		error = pr1_message_get_error_code(response);
+
+		if(TIO_FAILED(error))
+		{
+			if(!TIO_FAILED(result))
+				result = error;
+
+			pr1_message_delete(response);
+			response = NULL;
+			continue;
+		}
+
+		//
+		// each record starts with a key field
+		//
+		current = -1;
+
+		for(b = 0 ; b < response->field_count ; b++)
+		{
+			field = response->field_array[b];
+
+			if(field->field_id == MESSAGE_FIELD_ID_KEY)
+			{
+				current++;
+
+				if(received + current >= count)
+					break;
+
+				if(keys)
+					pr1_message_field_to_tio_data(field, &keys[received + current]);
+			}
+			else if(current < 0)
+				continue;
+			else if(field->field_id == MESSAGE_FIELD_ID_VALUE)
+			{
+				if(values)
+					pr1_message_field_to_tio_data(field, &values[received + current]);
+
+				if(results)
+					results[received + current] = TIO_SUCCESS;
+			}
+			else if(field->field_id == MESSAGE_FIELD_ID_METADATA)
+			{
+				if(metadatas)
+					pr1_message_field_to_tio_data(field, &metadatas[received + current]);
+			}
+		}
+
+		received += TIO_MAX_RECORDS_PER_MESSAGE;
+
+		pr1_message_delete(response);
+		response = NULL;
+	}
+
+	if (inside_network_batch)
+		tio_begin_network_batch(container->connection);
+
+	return TIO_FAILED(result) ? result : TIO_SUCCESS;
+}
+
 int tio_container_propget(struct TIO_CONTAINER* container, const struct TIO_DATA* search_key, struct TIO_DATA* value)
 {
 	return tio_container_send_command_and_get_data_response(
@@ -2047,7 +2990,7 @@ int tio_container_query(struct TIO_CONTAINER* container, int start, int end,
 		pr1_message_add_field_string(request, MESSAGE_FIELD_ID_QUERY_EXPRESSION, regex);
 
 
-	result = pr1_message_send_and_delete(container->connection->socket, request);
+	result = tio_message_send_and_delete(container->connection, request);
 	if(TIO_FAILED(result))
 		goto clean_up_and_return;
 
@@ -2159,7 +3102,7 @@ int tio_group_add(struct TIO_CONNECTION* connection, const char* group_name, con
 	pr1_message_add_field_string(request, MESSAGE_FIELD_ID_CONTAINER_NAME, container_name);
 
 
-	result = pr1_message_send_and_delete(connection->socket, request);
+	result = tio_message_send_and_delete(connection, request);
 	if(TIO_FAILED(result))
 		goto clean_up_and_return;
 
@@ -2203,7 +3146,7 @@ int tio_group_subscribe(struct TIO_CONNECTION* connection, const char* group_nam
 	if(start)
 		pr1_message_add_field_string(request, MESSAGE_FIELD_ID_START_RECORD, start);
 
-	result = pr1_message_send_and_delete(connection->socket, request);
+	result = tio_message_send_and_delete(connection, request);
 	if(TIO_FAILED(result))
 		goto clean_up_and_return;
 
@@ -2224,6 +3167,21 @@ clean_up_and_return:
 }
 
 
+void tio_set_no_reply(struct TIO_CONNECTION* connection, int no_reply, event_callback_t error_callback, void* cookie)
+{
+	connection->no_reply = no_reply;
+
+	//
+	// errors of writes already sent can still be pending,
+	// so leaving no-reply mode keeps the callback
+	//
+	if(!no_reply)
+		return;
+
+	connection->error_callback = error_callback;
+	connection->error_cookie = cookie;
+}
+
 void tio_begin_network_batch(struct TIO_CONNECTION* connection)
 {
 	assert(connection->pending_event_count == 0);
@@ -24,6 +24,7 @@
 	#include <sys/socket.h>
 	#include <sys/ioctl.h>
 	#include <netinet/in.h>
+	#include <netinet/tcp.h>
 	#include <netdb.h>
     #include <errno.h>
 	#define closesocket close
@@ -70,6 +71,24 @@ extern "C" {
 
 #define TIO_EVENT_SNAPSHOT_END			0x23
 
+//
+// Batch commands. The message has one key/value/metadata group per record
+// (fields not used by the command are left out), in this order. Answers
+// to GET_MANY have a key field for each record, followed by value and
+// metadata fields if the record exists
+//
+#define TIO_COMMAND_PUSH_BACK_MANY		0x24
+#define TIO_COMMAND_SET_MANY			0x25
+#define TIO_COMMAND_GET_MANY			0x26
+
+#define TIO_MAX_RECORDS_PER_MESSAGE		16384
+
+//
+// Error of a write sent in no-reply mode. The event has the
+// error code as result and the description as value
+//
+#define TIO_EVENT_ERROR					0x27
+
 #define TIO_COMMAND_PROPGET 			0x30
 #define TIO_COMMAND_PROPSET 			0x31
 
@@ -78,6 +97,12 @@ extern "C" {
 
 #define TIO_FAILED(x) (x < 0)
 
+#define TIO_PROTOCOL_BINARY				0x1
+#define TIO_PROTOCOL_COMPACT			0x2
+
+// can be combined with the others. String fields bigger than 4KB are compressed
+#define TIO_PROTOCOL_COMPRESSED			0x100
+
 #define TIO_DEBUG_FLAG_DUMP_MESSAGES_TO_STDOUT 0x01
 
 
@@ -139,11 +164,27 @@ void tio_initialize();
 void tio_set_debug_flags(int flags);
 
 int tio_connect(const char* host, short port, struct TIO_CONNECTION** connection);
+
+//
+// protocol is TIO_PROTOCOL_BINARY (PR1, what tio_connect uses) or 
+// TIO_PROTOCOL_COMPACT (PR2, smaller messages), optionally combined with
+// TIO_PROTOCOL_COMPRESSED
+//
+int tio_connect_ex(const char* host, short port, int protocol, struct TIO_CONNECTION** connection);
 void tio_disconnect(struct TIO_CONNECTION* connection);
 
 void tio_begin_network_batch(struct TIO_CONNECTION* connection);
 void tio_finish_network_batch(struct TIO_CONNECTION* connection);
 
+//
+// On no-reply mode, writes (push, set, insert, delete, clear, propset and the
+// _many versions) return as soon as they're sent. Errors are reported to 
+// error_callback when events are dispatched. Turning no-reply off keeps the
+// previous callback (error_callback and cookie are ignored), so errors of
+// writes already sent are still reported
+//
+void tio_set_no_reply(struct TIO_CONNECTION* connection, int no_reply, event_callback_t error_callback, void* cookie);
+
 int tio_create(struct TIO_CONNECTION* connection, const char* name, const char* type, struct TIO_CONTAINER** container);
 int tio_open(struct TIO_CONNECTION* connection, const char* name, const char* type, struct TIO_CONTAINER** container);
 int tio_close(struct TIO_CONTAINER* container);
@@ -168,6 +209,15 @@ int tio_container_insert(struct TIO_CONTAINER* container, const struct TIO_DATA*
 int tio_container_clear(struct TIO_CONTAINER* container);
 int tio_container_delete(struct TIO_CONTAINER* container, const struct TIO_DATA* key);
 int tio_container_get(struct TIO_CONTAINER* container, const struct TIO_DATA* search_key, struct TIO_DATA* key, struct TIO_DATA* value, struct TIO_DATA* metadata);
+
+//
+// keys, values and metadatas are arrays with count items, and can be NULL
+// if not used. Records are sent TIO_MAX_RECORDS_PER_MESSAGE per message.
+// results[n] is TIO_ERROR_NO_SUCH_OBJECT if search_keys[n] was not found
+//
+int tio_container_push_back_many(struct TIO_CONTAINER* container, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas);
+int tio_container_set_many(struct TIO_CONTAINER* container, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas);
+int tio_container_get_many(struct TIO_CONTAINER* container, unsigned int count, const struct TIO_DATA* search_keys, struct TIO_DATA* keys, struct TIO_DATA* values, struct TIO_DATA* metadatas, int* results);
 int tio_container_get_count(struct TIO_CONTAINER* container, int* count);
 int tio_container_query(struct TIO_CONTAINER* container, int start, int end, const char* regex, query_callback_t query_callback, void* cookie);
 int tio_container_subscribe(struct TIO_CONTAINER* container, struct TIO_DATA* start, event_callback_t event_callback, void* cookie);
@@ -11,6 +11,12 @@ extern "C" {
 #define MESSAGE_FIELD_TYPE_INT	 		0x3
 #define MESSAGE_FIELD_TYPE_DOUBLE		0x4
 
+//
+// Only on compressed connections ("protocol binary compressed"). A string
+// field with the uncompressed size (4 bytes) followed by the zlib data
+//
+#define MESSAGE_FIELD_TYPE_COMPRESSED	0x5
+
 #define MESSAGE_FIELD_ID_COMMAND 		0x1
 #define MESSAGE_FIELD_ID_HANDLE 		0x2
 #define MESSAGE_FIELD_ID_KEY	 		0x3
@@ -31,6 +37,18 @@ extern "C" {
 
 #define MESSAGE_FIELD_ID_QUERY_EXPRESSION 0x11
 
+//
+// Optional. The server echoes it on the answer, so a client can match answers
+// to requests instead of relying on the request order
+//
+#define MESSAGE_FIELD_ID_REQUEST_ID		0x12
+
+//
+// Optional. Successful writes aren't answered, errors are sent
+// as a TIO_EVENT_ERROR event
+//
+#define MESSAGE_FIELD_ID_NO_REPLY		0x13
+
 #define TIO_COMMAND_ANSWER				0x1
 #define TIO_COMMAND_EVENT				0x2
 #define TIO_COMMAND_QUERY_ITEM			0x3
@@ -94,6 +112,11 @@ struct TIO_CONNECTION
 	char* host;
 	unsigned short port;
 
+	int protocol;
+
+	// zero if the connection is not compressed
+	unsigned int compression_threshold;
+
 	struct EVENT_INFO_NODE* event_list_queue_end;
 	int pending_event_count;
 	int max_pending_event_count;
@@ -113,6 +136,10 @@ struct TIO_CONNECTION
 	int wait_for_answer;
 	int pending_answer_count;
 
+	int no_reply;
+	event_callback_t error_callback;
+	void* error_cookie;
+
 	int debug_flags;
 };
 
@@ -138,6 +165,7 @@ unsigned int stream_buffer_space_left(struct STREAM_BUFFER* stream_buffer);
 // PR1 protocol
 //
 struct PR1_MESSAGE* pr1_message_new();
+void pr1_message_reset(struct PR1_MESSAGE* pr1_message);
 
 void pr1_message_delete(struct PR1_MESSAGE* pr1_message);
 
@@ -165,11 +193,62 @@ struct PR1_MESSAGE* pr1_message_new_get_buffer_for_receive(struct PR1_MESSAGE_HE
 int pr1_message_receive(SOCKET socket, struct PR1_MESSAGE** pr1_message,
 	const unsigned* message_header_timeout_in_seconds, const unsigned* message_payload_timeout_in_seconds);
 
+//
+// PR2 protocol ("protocol compact"). Same fields as PR1, with less overhead:
+//
+//   message := varint(body size) body
+//   body    := varint(command) [varint(handle) varint(event code)] field*
+//   field   := varint(field_id << 3 | type) payload
+//
+// Handle and event code are only there if command is TIO_COMMAND_EVENT. 
+// Type is the PR1 type minus one. NONE has no payload, STRING and COMPRESSED
+// are varint(size) followed by the bytes, INT is a zigzag varint and DOUBLE
+// is 8 raw bytes. The tag takes one byte for field ids lower than 16.
+//
+// Encoders and decoders convert from and to PR1, so everything else keeps
+// working with PR1 messages
+//
+#define PR2_MAX_VARINT_SIZE 5
+#define PR2_FIELD_TAG(field_id, data_type) (((unsigned int)(field_id) << 3) | ((unsigned int)(data_type) - 1))
+
+unsigned int pr2_varint_encode(unsigned int value, char* output);
+int pr2_varint_decode(const char** current, const char* end, unsigned int* value);
+
+unsigned int pr2_encode_fields(const void* pr1_fields, unsigned int pr1_fields_size, char* output);
+unsigned int pr2_encode_message(const void* pr1_buffer, char* output);
+
+int pr2_read_message_size(const void* buffer, unsigned int buffer_size, unsigned int* body_size);
+int pr2_decode_message(const void* body, unsigned int body_size, struct PR1_MESSAGE* pr1_message);
+
+//
+// Field compression. Both return the number of fields compressed or expanded. If
+// it's zero, pr1_message is untouched and the original message must be used
+//
+#define TIO_DEFAULT_COMPRESSION_THRESHOLD (4 * 1024)
+
+//
+// The original size comes from the peer, so it's checked before we reserve
+// memory for it. Deflate can't compress more than about 1032:1, and a
+// message can't expand to more than PR1_MAX_DECOMPRESSED_SIZE
+//
+#define PR1_MAX_COMPRESSION_RATIO 1032
+#define PR1_MAX_DECOMPRESSED_SIZE (256 * 1024 * 1024)
+
+int pr1_compress_fields(const void* pr1_buffer, unsigned int threshold, struct PR1_MESSAGE* pr1_message);
+int pr1_decompress_fields(const void* pr1_buffer, struct PR1_MESSAGE* pr1_message);
+
+int tio_message_send_and_delete(struct TIO_CONNECTION* connection, struct PR1_MESSAGE* pr1_message);
+int tio_message_receive(struct TIO_CONNECTION* connection, struct PR1_MESSAGE** pr1_message,
+	const unsigned* message_header_timeout_in_seconds, const unsigned* message_payload_timeout_in_seconds);
+
 //
 // TODO: move to internal implementation file
 //
 struct PR1_MESSAGE* tio_generate_create_or_open_msg(unsigned int command_id, const char* name, const char* type);
 struct PR1_MESSAGE* tio_generate_data_message(unsigned int command_id, int handle, const struct TIO_DATA* key, const struct TIO_DATA* value, const struct TIO_DATA* metadata);
+struct PR1_MESSAGE* tio_generate_many_message(unsigned int command_id, int handle, unsigned int count, 
+	const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas);
+int tio_receive_until_not_event(struct TIO_CONNECTION* connection, struct PR1_MESSAGE** response);
 int pr1_message_get_error_code(struct PR1_MESSAGE* msg);
 void pr1_message_field_to_tio_data(const struct PR1_MESSAGE_FIELD_HEADER* field, struct TIO_DATA* tiodata);
 const char* message_field_id_to_string(int i);
@@ -3,6 +3,7 @@
 #include <string>
 #include <sstream>
 #include <functional>
+#include <vector>
 
 
 namespace tio
@@ -167,6 +168,47 @@ namespace tio
 		}
 	};
 
+	//
+	// Array of TIO_DATA for the batch functions. Owns the data, like TioDataConverter
+	//
+	class TioDataArray
+	{
+		std::vector<TIO_DATA> items_;
+
+		// non copyable
+		TioDataArray(const TioDataArray&);
+		TioDataArray& operator=(const TioDataArray&);
+
+	public:
+		explicit TioDataArray(size_t size)
+			: items_(size)
+		{
+			for(TIO_DATA& item : items_)
+				tiodata_init(&item);
+		}
+
+		~TioDataArray()
+		{
+			for(TIO_DATA& item : items_)
+				tiodata_set_as_none(&item);
+		}
+
+		size_t size() const
+		{
+			return items_.size();
+		}
+
+		TIO_DATA* ptr()
+		{
+			return items_.empty() ? nullptr : &items_[0];
+		}
+
+		TIO_DATA& operator[](size_t index)
+		{
+			return items_[index];
+		}
+	};
+
 	struct IContainerManager
 	{
 		virtual int create(const char* name, const char* type, void** handle)=0;
@@ -186,6 +228,9 @@ namespace tio
 		virtual int container_delete(void* handle, const struct TIO_DATA* key)=0;
 		virtual int container_get(void* handle, const struct TIO_DATA* search_key, struct TIO_DATA* key, struct TIO_DATA* value, struct TIO_DATA* metadata)=0;
 		virtual int container_propget(void* handle, const struct TIO_DATA* search_key, struct TIO_DATA* value)=0;
+		virtual int container_push_back_many(void* handle, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)=0;
+		virtual int container_set_many(void* handle, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)=0;
+		virtual int container_get_many(void* handle, unsigned int count, const struct TIO_DATA* search_keys, struct TIO_DATA* keys, struct TIO_DATA* values, struct TIO_DATA* metadatas, int* results)=0;
 		virtual int container_get_count(void* handle, int* count)=0;
 		virtual int container_query(void* handle, int start, int end, query_callback_t query_callback, void* cookie)=0;
 		virtual int container_subscribe(void* handle, struct TIO_DATA* start, event_callback_t event_callback, void* cookie)=0;
@@ -282,6 +327,21 @@ namespace tio
 			return tio_container_propget((TIO_CONTAINER*)handle, search_key, value);
 		}
 
+		virtual int container_push_back_many(void* handle, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)
+		{
+			return tio_container_push_back_many((TIO_CONTAINER*)handle, count, keys, values, metadatas);
+		}
+
+		virtual int container_set_many(void* handle, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)
+		{
+			return tio_container_set_many((TIO_CONTAINER*)handle, count, keys, values, metadatas);
+		}
+
+		virtual int container_get_many(void* handle, unsigned int count, const struct TIO_DATA* search_keys, struct TIO_DATA* keys, struct TIO_DATA* values, struct TIO_DATA* metadatas, int* results)
+		{
+			return tio_container_get_many((TIO_CONTAINER*)handle, count, search_keys, keys, values, metadatas, results);
+		}
+
 		virtual int container_get_count(void* handle, int* count)
 		{
 			return tio_container_get_count((TIO_CONTAINER*)handle, count);
@@ -743,6 +803,71 @@ namespace tio
 				return value.value();
 			}
 
+			//
+			// [first, last) are std::pair<key_type, value_type>, like map iterators
+			//
+			template<typename TIterator>
+			void set_many(TIterator first, TIterator last)
+			{
+				int result;
+				size_t count = std::distance(first, last);
+				TioDataArray keys(count), values(count);
+
+				for(size_t a = 0 ; first != last ; ++first, ++a)
+				{
+					ToTioData(first->first, &keys[a]);
+					ToTioData(first->second, &values[a]);
+				}
+
+				result = container_manager()->container_set_many(
+					container_, 
+					static_cast<unsigned int>(count),
+					keys.ptr(),
+					values.ptr(),
+					nullptr);
+
+				ThrowOnTioClientError(result);
+			}
+
+			//
+			// Keys not found will get defaultValue
+			//
+			std::vector<value_type> get_many(const std::vector<key_type>& searchKeys, const value_type& defaultValue)
+			{
+				int result;
+				size_t count = searchKeys.size();
+				TioDataArray tioSearchKeys(count), values(count);
+				std::vector<int> results(count);
+				std::vector<value_type> ret;
+
+				if(count == 0)
+					return ret;
+
+				for(size_t a = 0 ; a < count ; a++)
+					ToTioData(searchKeys[a], &tioSearchKeys[a]);
+
+				result = container_manager()->container_get_many(
+					container_, 
+					static_cast<unsigned int>(count),
+					tioSearchKeys.ptr(),
+					nullptr,
+					values.ptr(),
+					nullptr,
+					&results[0]);
+
+				ThrowOnTioClientError(result);
+
+				ret.resize(count, defaultValue);
+
+				for(size_t a = 0 ; a < count ; a++)
+				{
+					if(results[a] == TIO_SUCCESS)
+						FromTioData(&values[a], &ret[a]);
+				}
+
+				return ret;
+			}
+
 			void erase(const key_type& index)
 			{
 				int result;
@@ -808,6 +933,26 @@ namespace tio
 				ThrowOnTioClientError(result);
 			}
 
+			template<typename TIterator>
+			void push_back_many(TIterator first, TIterator last)
+			{
+				int result;
+				size_t count = std::distance(first, last);
+				TioDataArray values(count);
+
+				for(size_t a = 0 ; first != last ; ++first, ++a)
+					ToTioData(*first, &values[a]);
+
+				result = this->container_manager()->container_push_back_many(
+					this->container_, 
+					static_cast<unsigned int>(count),
+					nullptr,
+					values.ptr(),
+					nullptr);
+
+				ThrowOnTioClientError(result);
+			}
+
 			void push_front(const value_type& value)
 			{
 				int result;
@@ -216,7 +216,12 @@ namespace tio
 		std::vector< shared_ptr<PR1_MESSAGE> > pendingBinarySendData_;
 		std::vector< asio::const_buffer > beingSendData_;
 
-		std::queue< Pr1RequestInfo > waitingForAnswer_;
+		//
+		// every request carries MESSAGE_FIELD_ID_REQUEST_ID, so the server
+		// can answer them out of order
+		//
+		std::map<unsigned int, Pr1RequestInfo> waitingForAnswer_;
+		unsigned int lastRequestId_;
 
 		std::map<void*, t_event_callback> subscriptionCallbacks_;
 
@@ -246,6 +251,7 @@ namespace tio
 		AsyncConnection(asio::io_service& io_service)
 			: io_service_(&io_service)
 			, socket_(*io_service_)
+			, lastRequestId_(0)
 			, magic_(0xABCDABCD)
 			, useSeparatedThread_(false)
 		{
@@ -260,6 +266,7 @@ namespace tio
 		AsyncConnection(UseOwnThreadMode)
 			: io_service_(new asio::io_service())
 			, socket_(*io_service_)
+			, lastRequestId_(0)
 			, magic_(0xABCDABCD)
 			, useSeparatedThread_(true)
 		{
@@ -350,8 +357,25 @@ namespace tio
 			switch(command)
 			{
 			case TIO_COMMAND_ANSWER:
-				requestInfo = waitingForAnswer_.front();
-				waitingForAnswer_.pop();
+			{
+				int requestId;
+				std::map<unsigned int, Pr1RequestInfo>::iterator i = waitingForAnswer_.end();
+
+				if(Pr1MessageGetField(message, MESSAGE_FIELD_ID_REQUEST_ID, &requestId))
+					i = waitingForAnswer_.find(static_cast<unsigned int>(requestId));
+
+				//
+				// servers that don't support request ids answer in order
+				//
+				if(i == waitingForAnswer_.end())
+					i = waitingForAnswer_.begin();
+
+				if(i == waitingForAnswer_.end())
+					return;
+
+				requestInfo = i->second;
+				waitingForAnswer_.erase(i);
+			}
 
 				if(requestInfo.just_error_report_callback)
 				{
@@ -564,24 +588,36 @@ namespace tio
 				boost::bind(&AsyncConnection::OnBinaryMessageSent, this, asio::placeholders::error, asio::placeholders::bytes_transferred));
 		}
 
-		void SendBinaryMessage(Pr1RequestInfo requestInfo)
+		void QueueRequest(Pr1RequestInfo requestInfo)
 		{
+			//
+			// zero means "no request id" to the server
+			//
+			if(++lastRequestId_ == 0)
+				++lastRequestId_;
+
+			pr1_message_add_field_int(requestInfo.pending_message.get(), MESSAGE_FIELD_ID_REQUEST_ID, static_cast<int>(lastRequestId_));
+
 			requestInfo.debugCallInfo = Pr1MessageDump("", requestInfo.pending_message.get());
 
+			pendingBinarySendData_.push_back(requestInfo.pending_message);
+			waitingForAnswer_[lastRequestId_] = requestInfo;
+		}
+
+		void SendBinaryMessage(Pr1RequestInfo requestInfo)
+		{
 			if(useSeparatedThread_)
 			{
 				io_service_->post([this, requestInfo]()
 				{
-					pendingBinarySendData_.push_back(requestInfo.pending_message);
-					waitingForAnswer_.push(requestInfo);
+					QueueRequest(requestInfo);
 
 					this->SendPendingBinaryData();
 				});
 			}
 			else
 			{
-				pendingBinarySendData_.push_back(requestInfo.pending_message);
-				waitingForAnswer_.push(requestInfo);
+				QueueRequest(requestInfo);
 				
 				SendPendingBinaryData();
 			}
@@ -616,6 +616,11 @@ namespace tio { namespace BdbStorage
 			dispatcher_.Unsubscribe(cookie);
 		}
 
+		virtual bool SupportsConcurrentReads()
+		{
+			return false;
+		}
+
 
 		virtual string Get(const string& key)
 		{
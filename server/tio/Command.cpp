@@ -51,24 +51,93 @@ namespace tio
 
 
 	Command::Command():
-	separators_(" ")
+	id_(CommandId_Unknown),
+	separators_(" "),
+	data_(NULL),
+	dataSize_(0)
 	{}
 
-	void Command::Parse(const char* source)
+	void Command::Parse(std::string_view source)
 	{
-		boost::split(params_, source, boost::is_any_of(separators_));
+		params_.clear();
 
-		if(params_.size() == 0)
+		//
+		// every separator splits, so consecutive spaces give empty
+		// parameters, just like boost::split did
+		//
+		size_t start = 0;
+		bool singleSeparator = separators_[0] && !separators_[1];
+
+		for(;;)
 		{
-			params_.clear();
-			command_.clear();
-			throw std::invalid_argument("not a command");
+			size_t end = singleSeparator ? 
+				source.find(separators_[0], start) : 
+				source.find_first_of(separators_, start);
+
+			params_.emplace_back(source.substr(start, end == std::string_view::npos ? end : end - start));
+
+			if(end == std::string_view::npos)
+				break;
+
+			start = end + 1;
 		}
 
-		source_ = source;
+		source_.assign(source);
 
-		command_ = params_[0];
+		command_ = std::move(params_[0]);
 		params_.erase(params_.begin());
+
+		id_ = GetCommandId(command_);
+	}
+
+	CommandId Command::GetCommandId(std::string_view command)
+	{
+		typedef std::unordered_map<std::string_view, CommandId> CommandIdMap;
+
+		static const CommandIdMap ids = 
+		{
+			{"protocol", CommandId_Protocol},
+			{"ping", CommandId_Ping},
+			{"ver", CommandId_Ver},
+			{"compression_stats", CommandId_CompressionStats},
+			{"create", CommandId_Create},
+			{"open", CommandId_Open},
+			{"close", CommandId_Close},
+			{"delete_container", CommandId_DeleteContainer},
+			{"list_handles", CommandId_ListHandles},
+			{"push_back", CommandId_PushBack},
+			{"push_front", CommandId_PushFront},
+			{"pop_back", CommandId_PopBack},
+			{"pop_front", CommandId_PopFront},
+			{"modify", CommandId_Modify},
+			{"wnp_next", CommandId_WnpNext},
+			{"wnp_key", CommandId_WnpKey},
+			{"set", CommandId_Set},
+			{"insert", CommandId_Insert},
+			{"delete", CommandId_Delete},
+			{"clear", CommandId_Clear},
+			{"get_property", CommandId_GetProperty},
+			{"set_property", CommandId_SetProperty},
+			{"get", CommandId_Get},
+			{"get_count", CommandId_GetCount},
+			{"subscribe", CommandId_Subscribe},
+			{"unsubscribe", CommandId_Unsubscribe},
+			{"command", CommandId_Command},
+			{"auth", CommandId_Auth},
+			{"pause", CommandId_Pause},
+			{"resume", CommandId_Resume},
+			{"set_permission", CommandId_SetPermission},
+			{"query", CommandId_Query},
+			{"queryex", CommandId_QueryEx},
+			{"diff_start", CommandId_DiffStart},
+			{"diff", CommandId_Diff},
+			{"group_add", CommandId_GroupAdd},
+			{"group_subscribe", CommandId_GroupSubscribe},
+		};
+
+		CommandIdMap::const_iterator i = ids.find(command);
+
+		return i != ids.end() ? i->second : CommandId_Unknown;
 	}
 
 	const string& Command::GetCommand() const
@@ -76,6 +145,11 @@ namespace tio
 		return command_;
 	}
 
+	CommandId Command::GetId() const
+	{
+		return id_;
+	}
+
 	const string& Command::GetSource() const
 	{
 		return source_;
@@ -93,16 +167,19 @@ namespace tio
 		dump_container(params_, stream);
 	}
 
-	shared_ptr<tio::Buffer>& Command::GetDataBuffer()
+	const void* Command::GetData() const
 	{
-		if(!data_)
-			data_ = shared_ptr<tio::Buffer>(new tio::Buffer());
-
 		return data_;
+	}
 
+	size_t Command::GetDataSize() const
+	{
+		return dataSize_;
 	}
-	void Command::SetDataBuffer(const shared_ptr<tio::Buffer>& data)
+
+	void Command::SetData(const void* data, size_t dataSize)
 	{
 		data_ = data;
+		dataSize_ = dataSize;
 	}
 }
@@ -15,7 +15,6 @@ Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
    limitations under the License.
 */
 #pragma once
-#include "buffer.h"
 
 
 namespace tio
@@ -27,6 +26,53 @@ namespace tio
 	using std::pair;
 	using std::shared_ptr;
 
+	//
+	// Text protocol commands are interned when parsed, so the
+	// server dispatches and checks them by id instead of by name
+	//
+	enum CommandId
+	{
+		CommandId_Unknown,
+		CommandId_Protocol,
+		CommandId_Ping,
+		CommandId_Ver,
+		CommandId_CompressionStats,
+		CommandId_Create,
+		CommandId_Open,
+		CommandId_Close,
+		CommandId_DeleteContainer,
+		CommandId_ListHandles,
+		CommandId_PushBack,
+		CommandId_PushFront,
+		CommandId_PopBack,
+		CommandId_PopFront,
+		CommandId_Modify,
+		CommandId_WnpNext,
+		CommandId_WnpKey,
+		CommandId_Set,
+		CommandId_Insert,
+		CommandId_Delete,
+		CommandId_Clear,
+		CommandId_GetProperty,
+		CommandId_SetProperty,
+		CommandId_Get,
+		CommandId_GetCount,
+		CommandId_Subscribe,
+		CommandId_Unsubscribe,
+		CommandId_Command,
+		CommandId_Auth,
+		CommandId_Pause,
+		CommandId_Resume,
+		CommandId_SetPermission,
+		CommandId_Query,
+		CommandId_QueryEx,
+		CommandId_DiffStart,
+		CommandId_Diff,
+		CommandId_GroupAdd,
+		CommandId_GroupSubscribe,
+		CommandId_Count
+	};
+
 	class Command
 	{
 	public:
@@ -34,19 +80,30 @@ namespace tio
 	private:
 		Parameters params_;
 		string command_;
+		CommandId id_;
 		string source_;
 		const char* separators_;
-		shared_ptr<tio::Buffer> data_;
+
+		//
+		// points to the session receive buffer, it's only valid
+		// while the command is being executed
+		//
+		const void* data_;
+		size_t dataSize_;
 
 	public:
 		Command();
-		void Parse(const char* source);
+		void Parse(std::string_view source);
 		const string& GetSource() const;
 		const string& GetCommand() const;
+		CommandId GetId() const;
+
+		static CommandId GetCommandId(std::string_view command);
 		const Parameters& GetParameters() const;
 
-		shared_ptr<tio::Buffer>& GetDataBuffer();
-		void SetDataBuffer(const shared_ptr<tio::Buffer>& data);
+		const void* GetData() const;
+		size_t GetDataSize() const;
+		void SetData(const void* data, size_t dataSize);
 
 		void Dump(ostream& stream) const;
 	};
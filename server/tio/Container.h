@@ -171,17 +171,108 @@ namespace tio
 		{
 			None = 0, Int, Double, String, Invalid
 		};
+
+		//
+		// Strings up to this size (keys, small metadata) are stored inside
+		// the object, without allocating. Bigger ones go to the heap
+		//
+		static const size_t INLINE_STRING_CAPACITY = 15;
 	private:
+		//
+		// Bigger strings are refcounted. Data never changes after Set, so
+		// the copies (storage, events, result sets, send queues) all share
+		// the same bytes. The data follows this header
+		//
+		struct SharedString
+		{
+			std::atomic<unsigned int> refCount;
+
+			char* Data()
+			{
+				return reinterpret_cast<char*>(this + 1);
+			}
+
+			static SharedString* Create(size_t size)
+			{
+				SharedString* sharedString = new (::operator new(sizeof(SharedString) + size + 1)) SharedString;
+				sharedString->refCount = 1;
+				return sharedString;
+			}
+
+			void AddRef()
+			{
+				refCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void Release()
+			{
+				if(refCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+					return;
+
+				this->~SharedString();
+				::operator delete(this);
+			}
+		};
+
 		Type type_;
 		
 		union 
 		{
-			char* string_;
+			SharedString* sharedString_;
 			int int_;
 			double double_;
+			char inlineString_[INLINE_STRING_CAPACITY + 1];
 		};
 
 		size_t stringSize_;
+
+		bool IsInlineString() const
+		{
+			return stringSize_ <= INLINE_STRING_CAPACITY;
+		}
+
+		char* StringData()
+		{
+			return IsInlineString() ? inlineString_ : sharedString_->Data();
+		}
+
+		const char* StringData() const
+		{
+			return IsInlineString() ? inlineString_ : sharedString_->Data();
+		}
+
+		//
+		// takes the data and leaves the source empty
+		//
+		void MoveFrom(TioData& data)
+		{
+			Free();
+
+			switch(data.type_)
+			{
+			case Int:
+				int_ = data.int_;
+				break;
+			case Double:
+				double_ = data.double_;
+				break;
+			case String:
+				stringSize_ = data.stringSize_;
+
+				if(data.IsInlineString())
+					memcpy(inlineString_, data.inlineString_, stringSize_ + 1);
+				else
+					sharedString_ = data.sharedString_;
+
+				data.stringSize_ = 0;
+				break;
+			default:
+				return;
+			}
+
+			type_ = data.type_;
+			data.type_ = None;
+		}
 	public:
 
 		TioData()
@@ -230,17 +321,11 @@ namespace tio
 			Free();
 		}
 
-		/*TioData(TioData&& data)
+		TioData(TioData&& data) noexcept
 		{
-			type_ = data.type_;
-
-			if(data.type_ == None)
-				return;
-			
-			data.type_ = None;
-
-			double_ = data.double_;
-		}*/
+			type_ = None;
+			MoveFrom(data);
+		}
 
 		TioData(const TioData& data)
 		{
@@ -264,7 +349,17 @@ namespace tio
 
 		TioData& operator = (const TioData& data)
 		{
-			CopyFrom(data);
+			if(&data != this)
+				CopyFrom(data);
+
+			return *this;
+		}
+
+		TioData& operator = (TioData&& data) noexcept
+		{
+			if(&data != this)
+				MoveFrom(data);
+
 			return *this;
 		}
 
@@ -284,7 +379,15 @@ namespace tio
 				double_ = data.double_;
 				break;
 			case String:
-				Set(data.string_, data.stringSize_);
+				if(data.IsInlineString())
+				{
+					Set(data.inlineString_, data.stringSize_);
+					break;
+				}
+
+				sharedString_ = data.sharedString_;
+				sharedString_->AddRef();
+				stringSize_ = data.stringSize_;
 				break;
 			default:
 				Free();
@@ -349,18 +452,7 @@ namespace tio
 			switch(type)
 			{
 				case TioData::String:
-					this->type_ = TioData::String;
-					this->stringSize_ = size;
-					this->string_ = new char[size + 1];
-					
-					memcpy((void*)this->string_, &data[2], size);
-					
-					//
-					// We'll keep string zero terminated just in case. But
-					// the final \0 is not considered part of the data
-					//
-					((char*)this->string_)[size] = '\0';
-
+					Set(&data[2], size);
 					break;
 
 				case TioData::Int:
@@ -420,8 +512,9 @@ namespace tio
 
 			if(type_ == String)
 			{
-				delete string_;
-				string_ = NULL;
+				if(!IsInlineString())
+					sharedString_->Release();
+
 				stringSize_ = 0;
 			}
 				
@@ -461,12 +554,20 @@ namespace tio
 		{
 			Free();
 
-			string_= new char[size+1];
-			memcpy(string_, v, size);
-			string_[size] = '\0';
+			stringSize_ = size;
+
+			if(!IsInlineString())
+				sharedString_ = SharedString::Create(size);
+
+			//
+			// We'll keep string zero terminated just in case. But
+			// the final \0 is not considered part of the data
+			//
+			char* data = StringData();
+			memcpy(data, v, size);
+			data[size] = '\0';
 			
 			type_ = String;
-			stringSize_ = size;
 		}
 
 		void CheckDataType(Type t) const 
@@ -500,7 +601,7 @@ namespace tio
 		const char* AsSz() const 
 		{
 			CheckDataType(String);
-			return string_;
+			return StringData();
 		}
 
 		const void* AsRaw() const 
@@ -509,7 +610,7 @@ namespace tio
 			{
 				case Int : return const_cast<const int*>(&int_);
 				case Double : return &double_;
-				case String : return string_;
+				case String : return StringData();
 			}
 
 			throw std::runtime_error("wrong data type");
@@ -683,6 +784,31 @@ namespace tio
 		virtual void Insert(const TioData& key, const TioData& value, const TioData& metadata) = 0;
 		virtual void Delete(const TioData& key, const TioData& value, const TioData& metadata) = 0;
 
+		//
+		// Ownership taking writes. Storages that keep TioData in memory override
+		// these to move the value in instead of copying it. The default just
+		// falls back to the copying versions
+		//
+		virtual void PushBack(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			PushBack(key, static_cast<const TioData&>(value), static_cast<const TioData&>(metadata));
+		}
+
+		virtual void PushFront(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			PushFront(key, static_cast<const TioData&>(value), static_cast<const TioData&>(metadata));
+		}
+
+		virtual void Set(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			Set(key, static_cast<const TioData&>(value), static_cast<const TioData&>(metadata));
+		}
+
+		virtual void Insert(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			Insert(key, static_cast<const TioData&>(value), static_cast<const TioData&>(metadata));
+		}
+
 		virtual shared_ptr<ITioResultSet> Query(int startOffset, int endOffset, const TioData& query) = 0;
 
 		virtual void Clear() = 0;
@@ -694,6 +820,12 @@ namespace tio
 
 		virtual unsigned int Subscribe(EventSink sink, const string& start) = 0;
 		virtual void Unsubscribe(unsigned int cookie) = 0;
+
+		//
+		// true if GetRecord, GetRecordCount, Query and the property map Get
+		// don't change any state, so several threads can call them at once
+		//
+		virtual bool SupportsConcurrentReads() = 0;
 	};
 
 	INTERFACE ITioPropertyMap
@@ -725,9 +857,201 @@ namespace tio
 		virtual std::vector<StorageInfo> GetStorageList() = 0;
 	};
 
+	//
+	// Events written once per container and read by each subscriber at its
+	// own pace. It's a linked list of refcounted events: every reader holds
+	// the last event it has read, so old events are freed when the slowest
+	// reader moves past them. Readers that have nothing to read are woken
+	// up once by the next Append, so the writer only pays for idle readers
+	// and not for every subscriber
+	//
+	class EventQueue : boost::noncopyable
+	{
+	public:
+		struct Event : boost::noncopyable
+		{
+			Event()
+			{}
+
+			Event(const string& name, const TioData& key, const TioData& value, const TioData& metadata)
+				: name(name), key(key), value(value), metadata(metadata)
+			{}
+
+			~Event()
+			{
+				//
+				// a reader far behind would free a long chain recursively, so
+				// we free the events we're the last owner of in a loop
+				//
+				while(next && next.use_count() == 1)
+				{
+					shared_ptr<Event> afterNext = std::move(next->next);
+					next = std::move(afterNext);
+				}
+			}
+
+			string name;
+			TioData key, value, metadata;
+			shared_ptr<Event> next;
+
+			//
+			// The event encoded for each wire format. It's built by the first
+			// subscriber that sends the event and shared by all the others
+			//
+			enum EncodedFormat
+			{
+				EncodedBinary, EncodedCompact, EncodedText, 
+				EncodedBinaryCompressed, EncodedCompactCompressed, EncodedFormatCount
+			};
+
+			//
+			// A big value isn't copied into the encoded event. head ends right
+			// before the value bytes, that are written to the socket straight
+			// from the (shared) value, and tail has what comes after them
+			//
+			struct Encoded
+			{
+				string head;
+				TioData value;
+				string tail;
+
+				size_t GetSize() const
+				{
+					return head.size() + (value ? value.GetSize() : 0) + tail.size();
+				}
+			};
+
+			template<typename Encoder>
+			const shared_ptr<const Encoded>& GetEncoded(EncodedFormat format, Encoder encoder) const
+			{
+				std::call_once(encodedOnce_[format], [&](){ encoded_[format] = encoder(*this); });
+				return encoded_[format];
+			}
+
+		private:
+			mutable std::once_flag encodedOnce_[EncodedFormatCount];
+			mutable shared_ptr<const Encoded> encoded_[EncodedFormatCount];
+		};
+
+		class Reader : boost::noncopyable
+		{
+			friend class EventQueue;
+
+			shared_ptr<Event> last_;
+			function<void()> wakeup_;
+			bool idle_;
+
+		public:
+			explicit Reader(function<void()> wakeup)
+				: wakeup_(wakeup)
+				, idle_(false)
+			{}
+		};
+
+	private:
+		boost::mutex mutex_;
+		shared_ptr<Event> tail_;
+		vector<shared_ptr<Reader>> idleReaders_;
+
+	public:
+		EventQueue()
+			: tail_(std::make_shared<Event>())
+		{}
+
+		void Append(const string& name, const TioData& key, const TioData& value, const TioData& metadata)
+		{
+			shared_ptr<Event> event = std::make_shared<Event>(name, key, value, metadata);
+			vector<shared_ptr<Reader>> toWakeUp;
+
+			{
+				boost::mutex::scoped_lock lock(mutex_);
+
+				tail_->next = event;
+				tail_ = event;
+
+				toWakeUp.swap(idleReaders_);
+
+				for(auto& reader : toWakeUp)
+					reader->idle_ = false;
+			}
+
+			for(auto& reader : toWakeUp)
+				reader->wakeup_();
+		}
+
+		//
+		// the reader will get the events appended from now on. It starts idle,
+		// so it will be woken up by the next Append
+		//
+		shared_ptr<Reader> CreateReader(function<void()> wakeup)
+		{
+			shared_ptr<Reader> reader = std::make_shared<Reader>(wakeup);
+
+			boost::mutex::scoped_lock lock(mutex_);
+
+			reader->last_ = tail_;
+			reader->idle_ = true;
+			idleReaders_.push_back(reader);
+
+			return reader;
+		}
+
+		void RemoveReader(const shared_ptr<Reader>& reader)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+
+			idleReaders_.erase(
+				std::remove(idleReaders_.begin(), idleReaders_.end(), reader),
+				idleReaders_.end());
+
+			reader->idle_ = false;
+		}
+
+		//
+		// Returns up to maxEvents events. If there's nothing to read, the reader
+		// goes idle and its wakeup function will be called by the next Append
+		//
+		void Read(const shared_ptr<Reader>& reader, vector<shared_ptr<const Event>>* events, size_t maxEvents)
+		{
+			boost::mutex::scoped_lock lock(mutex_);
+
+			while(events->size() < maxEvents && reader->last_->next)
+			{
+				reader->last_ = reader->last_->next;
+				events->push_back(reader->last_);
+			}
+
+			if(events->empty() && !reader->idle_)
+			{
+				reader->idle_ = true;
+				idleReaders_.push_back(reader);
+			}
+		}
+	};
+
+	//
+	// a full record, used by the batch operations
+	//
+	struct TIO_RECORD
+	{
+		TIO_RECORD()
+		{}
+
+		TIO_RECORD(const TioData& key, const TioData& value, const TioData& metadata)
+			: key(key), value(value), metadata(metadata)
+		{}
+
+		TioData key, value, metadata;
+	};
+
 	INTERFACE ITioContainer
 	{
 		virtual string GetName() = 0;
+
+		//
+		// "type/name", with the type alias already resolved
+		//
+		virtual const string& GetFullQualifiedName() = 0;
 		virtual size_t GetRecordCount() = 0;
 
 		virtual string Command(const string& command) = 0;
@@ -744,6 +1068,39 @@ namespace tio
 		virtual void Set(const TioData& key, const TioData& value, const TioData& metadata = TIONULL) = 0;
 		virtual void Delete(const TioData& key, const TioData& value = TIONULL, const TioData& metadata = TIONULL) = 0;
 
+		//
+		// Same as above, but value and metadata are moved into the container.
+		// Containers that can't keep them just copy
+		//
+		virtual void PushBack(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			PushBack(key, static_cast<const TioData&>(value), static_cast<const TioData&>(metadata));
+		}
+
+		virtual void PushFront(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			PushFront(key, static_cast<const TioData&>(value), static_cast<const TioData&>(metadata));
+		}
+
+		virtual void Insert(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			Insert(key, static_cast<const TioData&>(value), static_cast<const TioData&>(metadata));
+		}
+
+		virtual void Set(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			Set(key, static_cast<const TioData&>(value), static_cast<const TioData&>(metadata));
+		}
+
+		//
+		// Batch operations, applied with a single container lock. If a record
+		// fails, the ones before it stay applied. GetMany doesn't throw for missing
+		// records, they're reported in found
+		//
+		virtual void PushBackMany(const vector<TIO_RECORD>& records) = 0;
+		virtual void SetMany(const vector<TIO_RECORD>& records) = 0;
+		virtual void GetMany(const vector<TioData>& searchKeys, vector<TIO_RECORD>* records, vector<bool>* found) = 0;
+
 		virtual shared_ptr<ITioResultSet> Query(int startOffset, int endOffset, const TioData& query) = 0;
 
 		virtual void Clear() = 0;
@@ -754,6 +1111,16 @@ namespace tio
 		virtual unsigned int Subscribe(EventSink sink, const string& start) = 0;
 		virtual void Unsubscribe(unsigned int cookie) = 0;
 
+		//
+		// Like Subscribe, but only the snapshot is sent to the sink. Live events
+		// are appended to the container EventQueue, and the subscriber reads them
+		// with ReadEvents after being woken up
+		//
+		virtual shared_ptr<EventQueue::Reader> SubscribeQueued(EventSink snapshotSink, const string& start, function<void()> wakeup) = 0;
+		virtual void UnsubscribeQueued(const shared_ptr<EventQueue::Reader>& reader) = 0;
+		virtual void ReadEvents(const shared_ptr<EventQueue::Reader>& reader, 
+			vector<shared_ptr<const EventQueue::Event>>* events, size_t maxEvents) = 0;
+
 		virtual string GetType() = 0;
 
 		virtual int WaitAndPopNext(EventSink sink) = 0;
@@ -803,7 +1170,39 @@ namespace tio
 	{
 		shared_ptr<ITioPropertyMap> propertyMap_;
 		shared_ptr<ITioStorage> storage_;
-		tio::recursive_mutex mutex_;
+		const string fullQualifiedName_;
+		tio::recursive_shared_mutex mutex_;
+		bool concurrentReads_;
+
+		//
+		// readers share the lock if the storage allows it. Writers
+		// (and everything that raises events) always lock exclusively
+		//
+		class ReadLock : boost::noncopyable
+		{
+			Container& container_;
+		public:
+			explicit ReadLock(Container& container)
+				: container_(container)
+			{
+				if(container_.concurrentReads_)
+					container_.mutex_.lock_shared();
+				else
+					container_.mutex_.lock();
+			}
+
+			~ReadLock()
+			{
+				if(container_.concurrentReads_)
+					container_.mutex_.unlock_shared();
+				else
+					container_.mutex_.unlock();
+			}
+		};
+
+		EventQueue eventQueue_;
+		unsigned int eventQueueCookie_;
+		size_t eventQueueReaders_;
 
 		unsigned int lastPopperId_;
 
@@ -849,50 +1248,67 @@ namespace tio
 
 	public:
 
-		Container(shared_ptr<ITioStorage> storage, shared_ptr<ITioPropertyMap> propertyMap) :
+		Container(shared_ptr<ITioStorage> storage, shared_ptr<ITioPropertyMap> propertyMap,
+			const string& fullQualifiedName) :
 			storage_(storage),
 			propertyMap_(propertyMap),
+			fullQualifiedName_(fullQualifiedName),
+			concurrentReads_(storage->SupportsConcurrentReads()),
+			eventQueueCookie_(0),
+			eventQueueReaders_(0),
 			lastPopperId_(0)
 		{}
 		
 		~Container()
 		{
-			return;
+			//
+			// the storage can outlive us (storage managers keep them)
+			//
+			if(eventQueueReaders_)
+				storage_->Unsubscribe(eventQueueCookie_);
 		}
 		
 		virtual string GetName()
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			ReadLock lock(*this);
 			return storage_->GetName();
 		}
 
 		virtual string GetType()
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			ReadLock lock(*this);
 			return storage_->GetType();
 		}
 
+		virtual const string& GetFullQualifiedName()
+		{
+			//
+			// never changes, no lock needed
+			//
+			return fullQualifiedName_;
+		}
+
 		virtual size_t GetRecordCount()
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			ReadLock lock(*this);
 			return storage_->GetRecordCount();
 		}
 
 		virtual void GetRecord(const TioData& searchKey, TioData* key,  TioData* value, TioData* metadata)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			ReadLock lock(*this);
 			storage_->GetRecord(searchKey, key, value, metadata);
 		}
 
 		virtual void PopBack(TioData* key, TioData* value, TioData* metadata)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			storage_->PopBack(key, value, metadata);
 		}
 
 		virtual void PopFront(TioData* key, TioData* value, TioData* metadata)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			storage_->PopFront(key, value, metadata);
 		}
 
@@ -931,14 +1347,14 @@ namespace tio
 				
 		virtual void PushBack(const TioData& key, const TioData& value, const TioData& metadata)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			storage_->PushBack(key, value, metadata);
 			HandleWaitAndPopNext();
 		}
 
 		virtual void PushFront(const TioData& key, const TioData& value, const TioData& metadata)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			storage_->PushFront(key, value, metadata);
 			HandleWaitAndPopNext();
 		}
@@ -946,66 +1362,185 @@ namespace tio
 		
 		virtual void Insert(const TioData& key, const TioData& value, const TioData& metadata)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			storage_->Insert(key, value, metadata);
 		}
 
 		virtual void Set(const TioData& key, const TioData& value, const TioData& metadata)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			storage_->Set(key, value, metadata);
 		}
 
+		virtual void PushBack(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
+			storage_->PushBack(key, std::move(value), std::move(metadata));
+			HandleWaitAndPopNext();
+		}
+
+		virtual void PushFront(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
+			storage_->PushFront(key, std::move(value), std::move(metadata));
+			HandleWaitAndPopNext();
+		}
+
+		virtual void Insert(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
+			storage_->Insert(key, std::move(value), std::move(metadata));
+		}
+
+		virtual void Set(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
+			storage_->Set(key, std::move(value), std::move(metadata));
+		}
+
 		virtual void Delete(const TioData& key, const TioData& value, const TioData& metadata)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			storage_->Delete(key, value, metadata);
 		}
 
+		virtual void PushBackMany(const vector<TIO_RECORD>& records)
+		{
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
+
+			for(const TIO_RECORD& record : records)
+			{
+				storage_->PushBack(record.key, record.value, record.metadata);
+				HandleWaitAndPopNext();
+			}
+		}
+
+		virtual void SetMany(const vector<TIO_RECORD>& records)
+		{
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
+
+			for(const TIO_RECORD& record : records)
+				storage_->Set(record.key, record.value, record.metadata);
+		}
+
+		virtual void GetMany(const vector<TioData>& searchKeys, vector<TIO_RECORD>* records, vector<bool>* found)
+		{
+			records->clear();
+			records->resize(searchKeys.size());
+
+			found->clear();
+			found->resize(searchKeys.size());
+
+			ReadLock lock(*this);
+
+			for(size_t a = 0 ; a < searchKeys.size() ; a++)
+			{
+				TIO_RECORD& record = (*records)[a];
+
+				try
+				{
+					storage_->GetRecord(searchKeys[a], &record.key, &record.value, &record.metadata);
+					(*found)[a] = true;
+				}
+				catch(std::exception&)
+				{
+					record = TIO_RECORD();
+					record.key = searchKeys[a];
+				}
+			}
+		}
+
 		virtual shared_ptr<ITioResultSet> Query(int startOffset, int endOffset, const TioData& query)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			ReadLock lock(*this);
 			return storage_->Query(startOffset, endOffset, query);
 		}
 
 		virtual void Clear()
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			storage_->Clear();
 		}
 
 		virtual string Command(const string& command)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			return storage_->Command(command);
 		}
 
 		virtual void SetProperty(const string& key, const string& value)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			propertyMap_->Set(key, value);
 		}
 
 		virtual string GetProperty(const string& key)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			ReadLock lock(*this);
 			return propertyMap_->Get(key);
 		}
 
 		virtual unsigned int Subscribe(EventSink sink, const string& start)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			return storage_->Subscribe(sink, start);
 		}
 		virtual void Unsubscribe(unsigned int cookie)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			storage_->Unsubscribe(cookie);
 		}
 
+		virtual shared_ptr<EventQueue::Reader> SubscribeQueued(EventSink snapshotSink, const string& start, function<void()> wakeup)
+		{
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
+
+			//
+			// the storage sends the snapshot while subscribing, we don't want
+			// its live events on this sink
+			//
+			storage_->Unsubscribe(storage_->Subscribe(snapshotSink, start));
+
+			//
+			// the queue is only fed while someone is reading it
+			//
+			if(eventQueueReaders_ == 0)
+			{
+				eventQueueCookie_ = storage_->Subscribe(
+					[this](const string& eventName, const TioData& key, const TioData& value, const TioData& metadata)
+					{
+						eventQueue_.Append(eventName, key, value, metadata);
+					}, 
+					string());
+			}
+
+			eventQueueReaders_++;
+
+			return eventQueue_.CreateReader(wakeup);
+		}
+
+		virtual void UnsubscribeQueued(const shared_ptr<EventQueue::Reader>& reader)
+		{
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
+
+			eventQueue_.RemoveReader(reader);
+
+			if(--eventQueueReaders_ == 0)
+				storage_->Unsubscribe(eventQueueCookie_);
+		}
+
+		virtual void ReadEvents(const shared_ptr<EventQueue::Reader>& reader, 
+			vector<shared_ptr<const EventQueue::Event>>* events, size_t maxEvents)
+		{
+			//
+			// the queue has its own lock, readers don't block the container
+			//
+			eventQueue_.Read(reader, events, maxEvents);
+		}
+
 		virtual int WaitAndPopNext(EventSink sink)
 		{
-			tio::recursive_mutex::scoped_lock lock(mutex_);
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 
 			if(storage_->GetRecordCount() > 0)
 			{
@@ -1033,6 +1568,7 @@ namespace tio
 
 		virtual void CancelWaitAndPopNext(int id)
 		{
+			tio::recursive_shared_mutex::scoped_lock lock(mutex_);
 			poppers_.remove_if(FindPopperInfoById(id));
 		}
 	};
@@ -1049,6 +1585,12 @@ namespace tio
 			
 		}
 
+		ValueAndMetadata(TioData&& value, TioData&& metadata) 
+			: value(std::move(value)), metadata(std::move(metadata))
+		{
+			
+		}
+
 		TioData value;
 		TioData metadata;
 	};
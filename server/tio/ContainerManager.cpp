@@ -19,6 +19,11 @@ Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
 
 namespace tio
 {
+	ContainerManager::ContainerManager()
+		: aliases_(std::make_shared<AliasesMap>())
+	{
+	}
+
 	void ContainerManager::RegisterFundamentalStorageManagers(
 		shared_ptr<ITioStorageManager> volatileList,
 		shared_ptr<ITioStorageManager> volatileMap)
@@ -74,27 +79,39 @@ namespace tio
 
 	shared_ptr<ITioContainer> ContainerManager::CreateOrOpen(string type, OperationType op, const string& name)
 	{
-		tio::recursive_mutex::scoped_lock lock(bigLock_);
-
 		type = ResolveAlias(type);
 
-		OpenContainersMap::const_iterator i = openContainers_.find(name);
-
 		//
 		// We MUST reuse the objects because the WaitAndPop support is implemented
 		// on the container level, not on the storage level
 		//
-		if(i != openContainers_.end() && !i->second.expired())
+		shared_ptr<ITioContainer> container = openContainers_.Find(name);
+
+		if(!container)
 		{
-			shared_ptr<ITioContainer> container = i->second.lock();
-			
-			// check if user didn't ask for wrong type
-			if(op == create && container->GetType() != type)
-				throw std::runtime_error("invalid container type");
+			tio::recursive_mutex::scoped_lock lock(bigLock_);
+
+			//
+			// someone else can have opened it while we were waiting for the lock
+			//
+			container = openContainers_.Find(name);
 
-			return container;
+			if(!container)
+				return CreateOrOpenStorage(type, op, name);
 		}
 
+		// check if user didn't ask for wrong type
+		if(op == create && container->GetType() != type)
+			throw std::runtime_error("invalid container type");
+
+		return container;
+	}
+
+	//
+	// bigLock_ must be held by the caller
+	//
+	shared_ptr<ITioContainer> ContainerManager::CreateOrOpenStorage(string type, OperationType op, const string& name)
+	{
 		shared_ptr<ITioStorage> storage;
 		shared_ptr<ITioPropertyMap> propertyMap;
 
@@ -121,9 +138,10 @@ namespace tio
 			pair_assign(storage, propertyMap) = storageManager->OpenStorage(type, name);
 		}
 
-		shared_ptr<ITioContainer> container(new Container(storage, propertyMap));
+		shared_ptr<ITioContainer> container(new Container(storage, propertyMap,
+			ResolveAlias(storage->GetType()) + "/" + storage->GetName()));
 
-		openContainers_[name] = container;
+		openContainers_.Insert(name, container);
 
 		return container;
 	}
@@ -155,8 +173,11 @@ namespace tio
 	{
 		tio::recursive_mutex::scoped_lock lock(bigLock_);
 
-		aliases_[alias] = type;
+		shared_ptr<AliasesMap> aliases = std::make_shared<AliasesMap>(*std::atomic_load(&aliases_));
 
+		(*aliases)[alias] = type;
+
+		std::atomic_store(&aliases_, shared_ptr<const AliasesMap>(aliases));
 	}
 
 	bool ContainerManager::Exists(const string& containerType, const string& containerName)
@@ -168,14 +189,14 @@ namespace tio
 
 	string ContainerManager::ResolveAlias(const string& type)
 	{
-		tio::recursive_mutex::scoped_lock lock(bigLock_);
-
 		if(type.empty())
 			return type;
 
-		AliasesMap::const_iterator iAlias = aliases_.find(type);
+		shared_ptr<const AliasesMap> aliases = std::atomic_load(&aliases_);
+
+		AliasesMap::const_iterator iAlias = aliases->find(type);
 
-		if(iAlias != aliases_.end())
+		if(iAlias != aliases->end())
 			return iAlias->second;
 		else
 			return type;
@@ -23,17 +23,67 @@ namespace tio
 	using std::shared_ptr;
 	using std::weak_ptr;
 
+	//
+	// Open containers by name. It's split in buckets, each one with its own
+	// reader/writer lock, so opening an already open container from several
+	// threads doesn't serialize on a single lock
+	//
+	class OpenContainersRegistry : boost::noncopyable
+	{
+		typedef std::unordered_map< string, weak_ptr<ITioContainer> > ContainersMap;
+
+		struct Bucket
+		{
+			boost::shared_mutex mutex;
+			ContainersMap containers;
+		};
+
+		static const size_t BUCKET_COUNT = 64;
+		Bucket buckets_[BUCKET_COUNT];
+
+		Bucket& GetBucket(const string& name)
+		{
+			return buckets_[std::hash<string>()(name) % BUCKET_COUNT];
+		}
+
+	public:
+		shared_ptr<ITioContainer> Find(const string& name)
+		{
+			Bucket& bucket = GetBucket(name);
+			boost::shared_lock<boost::shared_mutex> lock(bucket.mutex);
+
+			ContainersMap::const_iterator i = bucket.containers.find(name);
+
+			if(i == bucket.containers.end())
+				return shared_ptr<ITioContainer>();
+
+			return i->second.lock();
+		}
+
+		void Insert(const string& name, const shared_ptr<ITioContainer>& container)
+		{
+			Bucket& bucket = GetBucket(name);
+			boost::unique_lock<boost::shared_mutex> lock(bucket.mutex);
+
+			bucket.containers[name] = container;
+		}
+	};
+
 	class ContainerManager
 	{
 		typedef std::map<string, shared_ptr<ITioStorageManager> > ManagerByType;
 		typedef map< string, string > AliasesMap;
-		typedef map< string, weak_ptr<ITioContainer> > OpenContainersMap;
 
 		tio::recursive_mutex bigLock_;
 		ManagerByType managerByType_;
-		AliasesMap aliases_;
 
-		OpenContainersMap openContainers_;
+		//
+		// aliases almost never change, so AddAlias replaces the whole map
+		// and ResolveAlias just reads the current one without locking
+		//
+		shared_ptr<const AliasesMap> aliases_;
+
+		OpenContainersRegistry openContainers_;
 
 		enum OperationType
 		{
@@ -44,10 +94,13 @@ namespace tio
         shared_ptr<ITioContainer> meta_containers_, meta_availableTypes_;
 
 		shared_ptr<ITioContainer> CreateOrOpen(string type, OperationType op, const string& name);
+		shared_ptr<ITioContainer> CreateOrOpenStorage(string type, OperationType op, const string& name);
 
 		shared_ptr<ITioStorageManager> GetStorageManagerByType(string type);
 	public:
 
+		ContainerManager();
+
 		void AddAlias(const string& alias, const string& type);
 		
 		void RegisterFundamentalStorageManagers( shared_ptr<ITioStorageManager> volatileList, shared_ptr<ITioStorageManager> volatileMap);
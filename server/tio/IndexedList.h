@@ -0,0 +1,462 @@
+/*
+Tio: The Information Overlord
+Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#pragma once
+
+namespace tio
+{
+	using std::vector;
+	using std::unique_ptr;
+
+	//
+	// A sequence with O(log n) access, insert and erase by index. It's a B+tree
+	// where every node knows how many items it has, so we find an index walking
+	// down the counts. Items live in the leaves, that are linked to each other,
+	// so walking a range is sequential after the first lookup.
+	// References and iterators are only valid until the next change
+	//
+	template<typename T>
+	class IndexedList : boost::noncopyable
+	{
+		static const size_t LEAF_CAPACITY = 64;
+		static const size_t INNER_CAPACITY = 64;
+
+		//
+		// nodes with less than capacity / MIN_FILL_DIVISOR entries are merged
+		// with a neighbour, so deletes don't leave the tree full of almost
+		// empty nodes
+		//
+		static const size_t MIN_FILL_DIVISOR = 4;
+
+		struct Node : boost::noncopyable
+		{
+			explicit Node(bool leaf)
+				: leaf(leaf)
+				, count(0)
+				, prev(NULL)
+				, next(NULL)
+			{}
+
+			bool leaf;
+
+			// items in this subtree
+			size_t count;
+
+			// leaves only
+			vector<T> items;
+			Node* prev;
+			Node* next;
+
+			// inner nodes only
+			vector<unique_ptr<Node>> children;
+
+			size_t EntryCount() const
+			{
+				return leaf ? items.size() : children.size();
+			}
+		};
+
+		unique_ptr<Node> root_;
+		Node* first_;
+		Node* last_;
+
+	public:
+		class const_iterator
+		{
+			friend class IndexedList;
+
+			const Node* leaf_;
+			size_t position_;
+
+			const_iterator(const Node* leaf, size_t position)
+				: leaf_(leaf)
+				, position_(position)
+			{}
+
+		public:
+			const_iterator()
+				: leaf_(NULL)
+				, position_(0)
+			{}
+
+			const T& operator*() const
+			{
+				return leaf_->items[position_];
+			}
+
+			const T* operator->() const
+			{
+				return &leaf_->items[position_];
+			}
+
+			const_iterator& operator++()
+			{
+				if(++position_ == leaf_->items.size())
+				{
+					leaf_ = leaf_->next;
+					position_ = 0;
+				}
+
+				return *this;
+			}
+
+			bool operator==(const const_iterator& other) const
+			{
+				return leaf_ == other.leaf_ && position_ == other.position_;
+			}
+
+			bool operator!=(const const_iterator& other) const
+			{
+				return !(*this == other);
+			}
+		};
+
+		IndexedList()
+		{
+			clear();
+		}
+
+		size_t size() const
+		{
+			return root_->count;
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		void clear()
+		{
+			root_.reset(new Node(true));
+			first_ = last_ = root_.get();
+		}
+
+		T& operator[](size_t index)
+		{
+			size_t position;
+			Node* leaf = FindLeaf(index, &position);
+			return leaf->items[position];
+		}
+
+		const T& operator[](size_t index) const
+		{
+			size_t position;
+			const Node* leaf = FindLeaf(index, &position);
+			return leaf->items[position];
+		}
+
+		T& front()
+		{
+			return first_->items.front();
+		}
+
+		T& back()
+		{
+			return last_->items.back();
+		}
+
+		const_iterator begin() const
+		{
+			return empty() ? end() : const_iterator(first_, 0);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator();
+		}
+
+		//
+		// iterator to the item at index, or end() if index is size()
+		//
+		const_iterator iterator_at(size_t index) const
+		{
+			if(index >= size())
+				return end();
+
+			size_t position;
+			const Node* leaf = FindLeaf(index, &position);
+			return const_iterator(leaf, position);
+		}
+
+		void insert(size_t index, T&& item)
+		{
+			unique_ptr<Node> sibling = Insert(root_.get(), index, std::move(item));
+
+			if(!sibling)
+				return;
+
+			unique_ptr<Node> root(new Node(false));
+
+			root->count = root_->count + sibling->count;
+			root->children.push_back(std::move(root_));
+			root->children.push_back(std::move(sibling));
+
+			root_ = std::move(root);
+		}
+
+		void push_back(T&& item)
+		{
+			insert(size(), std::move(item));
+		}
+
+		void push_front(T&& item)
+		{
+			insert(0, std::move(item));
+		}
+
+		void erase(size_t index)
+		{
+			Erase(root_.get(), index);
+
+			if(root_->count == 0)
+			{
+				clear();
+				return;
+			}
+
+			while(!root_->leaf && root_->children.size() == 1)
+			{
+				unique_ptr<Node> child = std::move(root_->children.front());
+				root_ = std::move(child);
+			}
+		}
+
+		void pop_back()
+		{
+			erase(size() - 1);
+		}
+
+		void pop_front()
+		{
+			erase(0);
+		}
+
+	private:
+		//
+		// index must be a valid item index
+		//
+		Node* FindLeaf(size_t index, size_t* position) const
+		{
+			Node* node = root_.get();
+
+			while(!node->leaf)
+				node = node->children[FindChild(node, &index)].get();
+
+			*position = index;
+
+			return node;
+		}
+
+		//
+		// returns the child that has the item at index and
+		// changes index to be relative to that child
+		//
+		static size_t FindChild(const Node* node, size_t* index)
+		{
+			size_t i = 0;
+
+			while(*index >= node->children[i]->count)
+				*index -= node->children[i++]->count;
+
+			return i;
+		}
+
+		//
+		// When the insert is in one of the ends, we leave the node full and
+		// move just the new entry, so lists that only grow by push_back or
+		// push_front have full nodes
+		//
+		static size_t GetSplitPoint(size_t entryCount, size_t insertPosition)
+		{
+			if(insertPosition == entryCount - 1)
+				return entryCount - 1;
+			else if(insertPosition == 0)
+				return 1;
+			else
+				return entryCount / 2;
+		}
+
+		//
+		// returns the new right sibling if the node was split
+		//
+		unique_ptr<Node> Insert(Node* node, size_t index, T&& item)
+		{
+			node->count++;
+
+			if(node->leaf)
+			{
+				node->items.insert(node->items.begin() + index, std::move(item));
+
+				if(node->items.size() <= LEAF_CAPACITY)
+					return unique_ptr<Node>();
+
+				return Split(node, GetSplitPoint(node->items.size(), index));
+			}
+
+			//
+			// an insert between two children goes to the end of the left one.
+			// Appends (count was already incremented) go straight to the last
+			//
+			size_t i = 0;
+
+			if(index == node->count - 1)
+			{
+				i = node->children.size() - 1;
+				index = node->children[i]->count;
+			}
+			else
+			{
+				while(i + 1 < node->children.size() && index > node->children[i]->count)
+					index -= node->children[i++]->count;
+			}
+
+			unique_ptr<Node> sibling = Insert(node->children[i].get(), index, std::move(item));
+
+			if(!sibling)
+				return unique_ptr<Node>();
+
+			node->children.insert(node->children.begin() + i + 1, std::move(sibling));
+
+			if(node->children.size() <= INNER_CAPACITY)
+				return unique_ptr<Node>();
+
+			return Split(node, GetSplitPoint(node->children.size(), i + 1));
+		}
+
+		unique_ptr<Node> Split(Node* node, size_t splitPoint)
+		{
+			unique_ptr<Node> sibling(new Node(node->leaf));
+
+			if(node->leaf)
+			{
+				sibling->items.assign(
+					std::make_move_iterator(node->items.begin() + splitPoint),
+					std::make_move_iterator(node->items.end()));
+
+				node->items.erase(node->items.begin() + splitPoint, node->items.end());
+
+				sibling->count = sibling->items.size();
+
+				sibling->prev = node;
+				sibling->next = node->next;
+
+				if(node->next)
+					node->next->prev = sibling.get();
+				else
+					last_ = sibling.get();
+
+				node->next = sibling.get();
+			}
+			else
+			{
+				for(auto i = node->children.begin() + splitPoint ; i != node->children.end() ; ++i)
+				{
+					sibling->count += (*i)->count;
+					sibling->children.push_back(std::move(*i));
+				}
+
+				node->children.erase(node->children.begin() + splitPoint, node->children.end());
+			}
+
+			node->count -= sibling->count;
+
+			return sibling;
+		}
+
+		void Erase(Node* node, size_t index)
+		{
+			node->count--;
+
+			if(node->leaf)
+			{
+				node->items.erase(node->items.begin() + index);
+				return;
+			}
+
+			size_t i = FindChild(node, &index);
+			Node* child = node->children[i].get();
+
+			Erase(child, index);
+
+			if(child->count == 0)
+			{
+				if(child->leaf)
+					Unlink(child);
+
+				node->children.erase(node->children.begin() + i);
+				return;
+			}
+
+			size_t capacity = child->leaf ? LEAF_CAPACITY : INNER_CAPACITY;
+
+			if(child->EntryCount() >= capacity / MIN_FILL_DIVISOR)
+				return;
+
+			if(i + 1 < node->children.size())
+				Merge(node, i);
+			else if(i > 0)
+				Merge(node, i - 1);
+		}
+
+		//
+		// moves the child at index + 1 to the end of the child at index,
+		// if they fit in one node
+		//
+		void Merge(Node* node, size_t index)
+		{
+			Node* left = node->children[index].get();
+			Node* right = node->children[index + 1].get();
+
+			size_t capacity = left->leaf ? LEAF_CAPACITY : INNER_CAPACITY;
+
+			if(left->EntryCount() + right->EntryCount() > capacity)
+				return;
+
+			if(left->leaf)
+			{
+				left->items.insert(
+					left->items.end(),
+					std::make_move_iterator(right->items.begin()),
+					std::make_move_iterator(right->items.end()));
+
+				Unlink(right);
+			}
+			else
+			{
+				for(auto& child : right->children)
+					left->children.push_back(std::move(child));
+			}
+
+			left->count += right->count;
+
+			node->children.erase(node->children.begin() + index + 1);
+		}
+
+		void Unlink(Node* leaf)
+		{
+			if(leaf->prev)
+				leaf->prev->next = leaf->next;
+			else
+				first_ = leaf->next;
+
+			if(leaf->next)
+				leaf->next->prev = leaf->prev;
+			else
+				last_ = leaf->prev;
+		}
+	};
+}
@@ -16,6 +16,7 @@ Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
 */
 #pragma once
 #include "Container.h"
+#include "IndexedList.h"
 
 namespace tio {
 namespace MemoryStorage
@@ -24,11 +25,14 @@ namespace MemoryStorage
 	using std::string;
 	using std::vector;
 	using std::map;
-	using std::list;
 	using std::make_tuple;
 
 
-typedef list<ValueAndMetadata> ListType;
+//
+// indexed access (get, set, insert, delete, query and subscribe from
+// an index) is O(log n), see IndexedList
+//
+typedef IndexedList<ValueAndMetadata> ListType;
 
 class ListStorage : 
 	boost::noncopyable,
@@ -68,20 +72,34 @@ public:
 	  }
 
 	  virtual void PushBack(const TioData& key, const TioData& value, const TioData& metadata)
+	  {
+		  PushBack(key, TioData(value), TioData(metadata));
+	  }
+
+	  virtual void PushBack(const TioData& key, TioData&& value, TioData&& metadata)
 	  {
 		  CheckValue(value);
 		  
-		  data_.push_back(ValueAndMetadata(value, metadata));
+		  data_.push_back(ValueAndMetadata(std::move(value), std::move(metadata)));
+
+		  const ValueAndMetadata& data = data_.back();
 
-		  dispatcher_.RaiseEvent("push_back", static_cast<int>(data_.size() - 1), value, metadata);
+		  dispatcher_.RaiseEvent("push_back", static_cast<int>(data_.size() - 1), data.value, data.metadata);
 	  }
 
 	  virtual void PushFront(const TioData& key, const TioData& value, const TioData& metadata)
+	  {
+		  PushFront(key, TioData(value), TioData(metadata));
+	  }
+
+	  virtual void PushFront(const TioData& key, TioData&& value, TioData&& metadata)
 	  {
 		  CheckValue(value);
-		  data_.push_front(ValueAndMetadata(value, metadata));
+		  data_.push_front(ValueAndMetadata(std::move(value), std::move(metadata)));
 
-		  dispatcher_.RaiseEvent("push_front", 0, value, metadata);
+		  const ValueAndMetadata& data = data_.front();
+
+		  dispatcher_.RaiseEvent("push_front", 0, data.value, data.metadata);
 	  }
 
 	virtual void PopBack(TioData* key, TioData* value, TioData* metadata)
@@ -97,10 +115,10 @@ public:
 			*key = index;
 
 		if(value)
-			*value = data.value;
+			*value = std::move(data.value);
 
 		if(metadata)
-			*metadata = data.metadata;
+			*metadata = std::move(data.metadata);
 
 		data_.pop_back();
 
@@ -121,10 +139,10 @@ public:
 			*key = 0;
 
 		if(value)
-			*value = data.value;
+			*value = std::move(data.value);
 
 		if(metadata)
-			*metadata = data.metadata;
+			*metadata = std::move(data.metadata);
 
 		data_.pop_front();
 
@@ -140,89 +158,75 @@ public:
 			throw std::invalid_argument("value??");
 	}
 
-	ListType::iterator GetOffset(const TioData& key, size_t* realIndex = NULL, bool canBeTheEnd = false)
+	size_t GetIndex(const TioData& key, bool canBeTheEnd = false)
 	{
-		int index = NormalizeIndex(key.AsInt(), data_.size());
-		
-		if(realIndex)
-			*realIndex = index;
+		int index = key.AsInt();
+
+		if(canBeTheEnd && index == static_cast<int>(data_.size()))
+			return data_.size();
 
-		ListType::iterator i;
+		size_t realIndex = NormalizeIndex(index, data_.size());
 
 		//
-		// advance a list iterator is expensive. If it's near the end, will
-		// walk backwards
+		// NormalizeIndex doesn't check index zero
 		//
-		if (data_.empty())
-		{
-			i = data_.end();
-		}
-		else if(index <= static_cast<int>(data_.size() / 2))
-		{
-			i = data_.begin();
-			for(int x = 0  ; x < index ; ++x, ++i)
-				;
-		}
-		else
-		{
-			i = data_.end();
+		if(realIndex >= data_.size())
+			throw std::invalid_argument("out of bounds");
 
-			int walk = data_.size() - index;
-
-			for(int x = 0  ; x < walk ; ++x, --i)
-				;
-		}
-
-		return i;
+		return realIndex;
 	}
 
 	virtual void Set(const TioData& key, const TioData& value, const TioData& metadata)
 	{
-		ListType::iterator i = GetOffset(key);
-		
-		ValueAndMetadata& valueAndMetadata = *i;
+		Set(key, TioData(value), TioData(metadata));
+	}
 
-		if(value)
-			valueAndMetadata.value = value;
+	virtual void Set(const TioData& key, TioData&& value, TioData&& metadata)
+	{
+		ValueAndMetadata& valueAndMetadata = data_[GetIndex(key)];
 
-		if(metadata)
-			valueAndMetadata.metadata = metadata;
+		bool hasValue = !!value, hasMetadata = !!metadata;
+
+		if(hasValue)
+			valueAndMetadata.value = std::move(value);
 
-		dispatcher_.RaiseEvent("set", key, value, metadata); 
+		if(hasMetadata)
+			valueAndMetadata.metadata = std::move(metadata);
+
+		dispatcher_.RaiseEvent("set", key, 
+			hasValue ? valueAndMetadata.value : TIONULL, 
+			hasMetadata ? valueAndMetadata.metadata : TIONULL); 
 	}
 
 	virtual void Insert(const TioData& key, const TioData& value, const TioData& metadata)
 	{
-		size_t index = key.AsInt();
+		Insert(key, TioData(value), TioData(metadata));
+	}
 
-		if(index == 0)
-			data_.push_front(ValueAndMetadata(value, metadata));
-		else if (index == data_.size())
-			data_.push_back(ValueAndMetadata(value, metadata));
-		else
-		{
-			ListType::iterator i = GetOffset(key);
-			data_.insert(i, ValueAndMetadata(value, metadata));
-		}
+	virtual void Insert(const TioData& key, TioData&& value, TioData&& metadata)
+	{
+		size_t index = GetIndex(key, true);
+
+		data_.insert(index, ValueAndMetadata(std::move(value), std::move(metadata)));
+
+		const ValueAndMetadata& data = data_[index];
 
-		dispatcher_.RaiseEvent("insert", key, value, metadata); 
+		dispatcher_.RaiseEvent("insert", key, data.value, data.metadata); 
 	}
 
 	virtual void Delete(const TioData& key, const TioData& value, const TioData& metadata)
 	{
-		TioData realKey;
-		size_t realIndex;
+		//
+		// deleting index 0 of an empty list is not an error
+		//
+		if(data_.empty() && key.AsInt() == 0)
+			return;
 
-		ListType::iterator i = GetOffset(key, &realIndex);
-		
-		if (i != data_.end())
-		{
-			realKey.Set(static_cast<int>(realIndex));
+		size_t index = GetIndex(key);
 
-			data_.erase(i);
+		data_.erase(index);
 
-			dispatcher_.RaiseEvent("delete", realKey, value, metadata);
-		}
+		dispatcher_.RaiseEvent("delete", static_cast<int>(index), value, metadata);
 	}
 
 	virtual void Clear()
@@ -237,44 +241,30 @@ public:
 		if(!query.IsNull())
 			throw std::runtime_error("query type not supported by this container");
 
-		ListType::const_iterator begin, end;
-
 		//
 		// if client is asking for a negative index that's bigger than the container,
 		// will start from beginning. Ex: if container size is 3 and start = -5, will start from 0
 		//
 		if(GetRecordCount() == 0)
 		{
-			begin = end = data_.end();
-			startOffset = 0;
+			startOffset = endOffset = 0;
 		}
 		else
 		{
 			int recordCount = GetRecordCount();
 
 			NormalizeQueryLimits(&startOffset, &endOffset, recordCount);
-			
-			if(startOffset == 0)
-				begin = data_.begin();
-			else if(startOffset == recordCount)
-				begin = data_.end();
-			else
-				begin = GetOffset(startOffset);
-
-			if(endOffset == 0)
-				end = data_.begin();
-			else if(endOffset == recordCount)
-				end = data_.end();
-			else
-				end = GetOffset(endOffset);	
 		}
 
 		VectorResultSet::ContainerT resultSetItems;
 
-		resultSetItems.reserve(endOffset - startOffset);
+		if(endOffset > startOffset)
+			resultSetItems.reserve(endOffset - startOffset);
 
-		for(int key = startOffset; begin != end; ++begin, ++key)
-			resultSetItems.push_back(make_tuple(TioData(key), begin->value, begin->metadata));
+		ListType::const_iterator i = data_.iterator_at(startOffset);
+
+		for(int key = startOffset; key < endOffset; ++i, ++key)
+			resultSetItems.emplace_back(key, i->value, i->metadata);
 
 		return shared_ptr<ITioResultSet>(
 			new VectorResultSet(std::move(resultSetItems), TIONULL));
@@ -307,7 +297,8 @@ public:
 		size_t realIndex;
 		try
 		{
-			i = GetOffset(startIndex, &realIndex);
+			realIndex = GetIndex(startIndex);
+			i = data_.iterator_at(realIndex);
 		}
 		catch(std::invalid_argument&)
 		{
@@ -353,19 +344,24 @@ public:
 		dispatcher_.Unsubscribe(cookie);
 	}
 
+	virtual bool SupportsConcurrentReads()
+	{
+		return true;
+	}
+
 	virtual void GetRecord(const TioData& searchKey, TioData* key,  TioData* value, TioData* metadata)
 	{
-		size_t realIndex = 0;
-		ListType::iterator i = GetOffset(searchKey, &realIndex);
+		size_t realIndex = GetIndex(searchKey);
+		const ValueAndMetadata& data = data_[realIndex];
 
 		if(key)
 			*key = static_cast<int>(realIndex);
 
 		if(value)
-			*value = i->value;
+			*value = data.value;
 
 		if(metadata)
-			*metadata = i->metadata;
+			*metadata = data.metadata;
 
 	}
 };
@@ -350,7 +350,7 @@ namespace tio {
 				{
 					TioData key, value, metadata;
 					GetRecord(TioData(index), &key, &value, &metadata);
-					resultSetItems.push_back(make_tuple(key, value, metadata));
+					resultSetItems.emplace_back(std::move(key), std::move(value), std::move(metadata));
 				}
 
 				return shared_ptr<ITioResultSet>(
@@ -462,6 +462,14 @@ namespace tio {
 				dispatcher_.Unsubscribe(cookie);
 			}
 
+			virtual bool SupportsConcurrentReads()
+			{
+				//
+				// reads go to the log file and move its position
+				//
+				return false;
+			}
+
 			virtual string Get(const string& key)
 			{
 				BOOST_ASSERT(accessType_ == Map);
@@ -36,7 +36,7 @@ private:
 	string name_, type_;
 	EventDispatcher dispatcher_;
 
-	inline pair<const string, ValueAndMetadata> GetInternalRecord(const TioData& key)
+	inline DataMap::value_type& GetInternalRecord(const TioData& key)
 	{
 		if(key.GetDataType() == TioData::Int)
 		{
@@ -137,16 +137,28 @@ public:
 	  }
 
 	  virtual void Set(const TioData& key, const TioData& value, const TioData& metadata)
+	  {
+		  Set(key, TioData(value), TioData(metadata));
+	  }
+
+	  virtual void Set(const TioData& key, TioData&& value, TioData&& metadata)
 	  {
 		  if(!key)
 			  throw std::invalid_argument("invalid key");
 
-		  data_[key.AsSz()] = ValueAndMetadata(value, metadata);
+		  ValueAndMetadata& data = data_[key.AsSz()];
+		  
+		  data = ValueAndMetadata(std::move(value), std::move(metadata));
 
-		  dispatcher_.RaiseEvent("set", key, value, metadata);
+		  dispatcher_.RaiseEvent("set", key, data.value, data.metadata);
 	  }
 
 	  virtual void Insert(const TioData& key, const TioData& value, const TioData& metadata)
+	  {
+		  Insert(key, TioData(value), TioData(metadata));
+	  }
+
+	  virtual void Insert(const TioData& key, TioData&& value, TioData&& metadata)
 	  {
 		  if(!key)
 			  throw std::invalid_argument("invalid key");
@@ -156,9 +168,11 @@ public:
 		  if(key_found(data_, keyString))
 			  throw std::invalid_argument("already exits");
 
-		  data_[keyString] = ValueAndMetadata(value, metadata);
+		  ValueAndMetadata& data = data_[keyString];
+		  
+		  data = ValueAndMetadata(std::move(value), std::move(metadata));
 
-		  dispatcher_.RaiseEvent("insert", key, value, metadata);
+		  dispatcher_.RaiseEvent("insert", key, data.value, data.metadata);
 	  }
 
 	  virtual void Delete(const TioData& key, const TioData& value, const TioData& metadata)
@@ -228,7 +242,7 @@ public:
 		  resultSetItems.reserve(distance(start, end));
 
 		  for(; start != end; ++start)
-			  resultSetItems.push_back(make_tuple(start->first, start->second.value, start->second.metadata));
+			  resultSetItems.emplace_back(start->first, start->second.value, start->second.metadata);
 
 		  return shared_ptr<ITioResultSet>(
 			  new VectorResultSet(std::move(resultSetItems), TIONULL));
@@ -301,9 +315,14 @@ public:
 		  dispatcher_.Unsubscribe(cookie);
 	  }
 
+	  virtual bool SupportsConcurrentReads()
+	  {
+		  return true;
+	  }
+
 	  virtual void GetRecord(const TioData& searchKey, TioData* key, TioData* value, TioData* metadata)
 	  {
-		  pair<string, ValueAndMetadata> p = GetInternalRecord(searchKey);
+		  const DataMap::value_type& p = GetInternalRecord(searchKey);
 		  const ValueAndMetadata& data = p.second;
 
 		  //
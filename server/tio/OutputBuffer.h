@@ -0,0 +1,188 @@
+/*
+Tio: The Information Overlord
+Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#pragma once
+
+#include "pch.h"
+#include <boost/lockfree/stack.hpp>
+
+namespace tio
+{
+	namespace asio = boost::asio;
+
+	struct OUTPUT_BLOCK
+	{
+		static const size_t CAPACITY = 16 * 1024;
+
+		size_t begin;
+		size_t end;
+		char data[CAPACITY];
+	};
+
+	//
+	// Free list of output blocks shared by all sessions. Blocks are only
+	// deleted if there are more than MAX_FREE_BLOCKS free
+	//
+	class OutputBlockPool : boost::noncopyable
+	{
+		static const size_t MAX_FREE_BLOCKS = 1024;
+
+		boost::lockfree::stack<OUTPUT_BLOCK*> freeBlocks_;
+
+		OutputBlockPool()
+			: freeBlocks_(MAX_FREE_BLOCKS)
+		{
+		}
+
+	public:
+		~OutputBlockPool()
+		{
+			OUTPUT_BLOCK* block;
+
+			while(freeBlocks_.pop(block))
+				delete block;
+		}
+
+		static OutputBlockPool& Instance()
+		{
+			static OutputBlockPool pool;
+			return pool;
+		}
+
+		OUTPUT_BLOCK* Alloc()
+		{
+			OUTPUT_BLOCK* block;
+
+			if(!freeBlocks_.pop(block))
+				block = new OUTPUT_BLOCK;
+
+			block->begin = block->end = 0;
+
+			return block;
+		}
+
+		void Free(OUTPUT_BLOCK* block)
+		{
+			if(!freeBlocks_.bounded_push(block))
+				delete block;
+		}
+	};
+
+	//
+	// Chain of pooled blocks. Data is appended at the tail while the
+	// head is being written to the socket, so a single write can take
+	// everything that was queued since the last one. Not thread safe
+	//
+	class ChainedOutputBuffer : boost::noncopyable
+	{
+		std::deque<OUTPUT_BLOCK*> blocks_;
+		size_t size_;
+
+	public:
+		ChainedOutputBuffer()
+			: size_(0)
+		{
+		}
+
+		~ChainedOutputBuffer()
+		{
+			Clear();
+		}
+
+		size_t GetSize() const
+		{
+			return size_;
+		}
+
+		bool IsEmpty() const
+		{
+			return size_ == 0;
+		}
+
+		void Append(const void* data, size_t size)
+		{
+			const char* source = static_cast<const char*>(data);
+
+			size_ += size;
+
+			while(size)
+			{
+				if(blocks_.empty() || blocks_.back()->end == OUTPUT_BLOCK::CAPACITY)
+					blocks_.push_back(OutputBlockPool::Instance().Alloc());
+
+				OUTPUT_BLOCK* block = blocks_.back();
+				size_t toCopy = (std::min)(size, OUTPUT_BLOCK::CAPACITY - block->end);
+
+				memcpy(block->data + block->end, source, toCopy);
+
+				block->end += toCopy;
+				source += toCopy;
+				size -= toCopy;
+			}
+		}
+
+		//
+		// The buffers point to the blocks, so they're valid until
+		// the data is consumed. Returns the buffered size
+		//
+		size_t GetBuffers(std::vector<asio::const_buffer>* buffers, size_t maxBuffers) const
+		{
+			size_t size = 0;
+
+			for(OUTPUT_BLOCK* block : blocks_)
+			{
+				if(buffers->size() == maxBuffers)
+					break;
+
+				buffers->push_back(asio::buffer(block->data + block->begin, block->end - block->begin));
+				size += block->end - block->begin;
+			}
+
+			return size;
+		}
+
+		void Consume(size_t size)
+		{
+			BOOST_ASSERT(size <= size_);
+
+			size_ -= size;
+
+			while(size)
+			{
+				OUTPUT_BLOCK* block = blocks_.front();
+				size_t toConsume = (std::min)(size, block->end - block->begin);
+
+				block->begin += toConsume;
+				size -= toConsume;
+
+				if(block->begin == block->end)
+				{
+					blocks_.pop_front();
+					OutputBlockPool::Instance().Free(block);
+				}
+			}
+		}
+
+		void Clear()
+		{
+			for(OUTPUT_BLOCK* block : blocks_)
+				OutputBlockPool::Instance().Free(block);
+
+			blocks_.clear();
+			size_ = 0;
+		}
+	};
+}
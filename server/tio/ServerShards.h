@@ -0,0 +1,173 @@
+/*
+Tio: The Information Overlord
+Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+#pragma once
+
+#include "pch.h"
+#include <boost/lockfree/queue.hpp>
+
+namespace tio
+{
+	namespace asio = boost::asio;
+
+	using std::function;
+	using std::string;
+	using std::vector;
+	using std::unique_ptr;
+
+	//
+	// One io_service running on its own thread. Containers are owned by
+	// a shard (see ServerShards::GetContainerOwner) and binary data commands
+	// for them are executed by the owner thread, so a container will not
+	// bounce between cores. This is not shared-nothing: containers and
+	// managers keep their locks, and everything else runs on the thread
+	// of the session
+	//
+	class ServerShard : boost::noncopyable
+	{
+		asio::io_service io_service_;
+		asio::io_service::work work_;
+		boost::thread thread_;
+
+		//
+		// Commands from other shards. We post a single drain callback to the
+		// io_service no matter how many commands are queued
+		//
+		boost::lockfree::queue<function<void()>*> commands_;
+		std::atomic<bool> drainPending_;
+
+		void DrainCommands()
+		{
+			//
+			// must be cleared before draining, otherwise a command
+			// pushed right after the last pop would never run
+			//
+			drainPending_ = false;
+
+			function<void()>* command;
+
+			while(commands_.pop(command))
+			{
+				unique_ptr<function<void()>> holder(command);
+				(*command)();
+			}
+		}
+
+	public:
+		ServerShard()
+			: work_(io_service_)
+			, commands_(1024)
+			, drainPending_(false)
+		{
+		}
+
+		~ServerShard()
+		{
+			function<void()>* command;
+
+			while(commands_.pop(command))
+				delete command;
+		}
+
+		void Start()
+		{
+			thread_ = boost::thread([this](){ io_service_.run(); });
+		}
+
+		void Stop()
+		{
+			io_service_.stop();
+
+			if(thread_.joinable())
+				thread_.join();
+		}
+
+		asio::io_service& GetIoService()
+		{
+			return io_service_;
+		}
+
+		bool IsCurrentThread() const
+		{
+			return thread_.get_id() == boost::this_thread::get_id();
+		}
+
+		void Post(function<void()> command)
+		{
+			commands_.push(new function<void()>(std::move(command)));
+
+			if(!drainPending_.exchange(true))
+				io_service_.post([this](){ DrainCommands(); });
+		}
+	};
+
+	class ServerShards : boost::noncopyable
+	{
+		vector<unique_ptr<ServerShard>> shards_;
+		std::atomic<unsigned> nextSessionShard_;
+
+	public:
+		explicit ServerShards(unsigned count)
+			: nextSessionShard_(0)
+		{
+			if(count == 0)
+				count = 1;
+
+			for(unsigned a = 0 ; a < count ; a++)
+				shards_.emplace_back(new ServerShard());
+		}
+
+		~ServerShards()
+		{
+			Stop();
+		}
+
+		void Start()
+		{
+			for(auto& shard : shards_)
+				shard->Start();
+		}
+
+		void Stop()
+		{
+			for(auto& shard : shards_)
+				shard->Stop();
+		}
+
+		size_t GetCount() const
+		{
+			return shards_.size();
+		}
+
+		//
+		// new sessions are spread round robin
+		//
+		ServerShard& GetNextSessionShard()
+		{
+			return *shards_[nextSessionShard_++ % shards_.size()];
+		}
+
+		ServerShard& GetShard(size_t index)
+		{
+			return *shards_[index % shards_.size()];
+		}
+
+		ServerShard& GetContainerOwner(const string& fullQualifiedName)
+		{
+			return *shards_[std::hash<string>()(fullQualifiedName) % shards_.size()];
+		}
+	};
+}
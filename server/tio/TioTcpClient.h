@@ -129,6 +129,7 @@ namespace tio
 	{
 		RemoteContainerManager& manager_;
 		string handle_;
+		string fullQualifiedName_;
 
 		void ThrowAnswerIfError(const ProtocolAnswer& answer);
 		void SendCommand(const string& command, ProtocolAnswer* answer, 
@@ -169,8 +170,13 @@ namespace tio
 		virtual void Clear();
 		virtual shared_ptr<ITioResultSet> Query(int startOffset, int endOffset, const TioData& query);
 
+		virtual void PushBackMany(const vector<TIO_RECORD>& records);
+		virtual void SetMany(const vector<TIO_RECORD>& records);
+		virtual void GetMany(const vector<TioData>& searchKeys, vector<TIO_RECORD>* records, vector<bool>* found);
+
 		virtual string GetType();
 		virtual string GetName();
+		virtual const string& GetFullQualifiedName();
 
 		virtual string Command(const string& command);
 
@@ -180,6 +186,20 @@ namespace tio
 		virtual unsigned int Subscribe(EventSink sink, const string& start);
 		virtual void Unsubscribe(unsigned int cookie);
 
+		virtual shared_ptr<EventQueue::Reader> SubscribeQueued(EventSink snapshotSink, const string& start, function<void()> wakeup)
+		{
+			throw std::runtime_error("not implemented");
+		}
+		virtual void UnsubscribeQueued(const shared_ptr<EventQueue::Reader>& reader)
+		{
+			throw std::runtime_error("not implemented");
+		}
+		virtual void ReadEvents(const shared_ptr<EventQueue::Reader>& reader, 
+			vector<shared_ptr<const EventQueue::Event>>* events, size_t maxEvents)
+		{
+			throw std::runtime_error("not implemented");
+		}
+
 		virtual void Modify(const TioData& key, TioData* value);
 
 		virtual int WaitAndPopNext(EventSink sink)
@@ -77,52 +77,129 @@ namespace tio
 		MakeAnswerEnd(stream);
 	}
 
-	inline void SerializeData(const TioData& key, const TioData& value, const TioData& metadata, ostream& stream)
+	//
+	// Text form of a TioData. Numbers are formatted with to_chars on our own
+	// buffer (doubles like the "%g" streams used before), strings point
+	// to the TioData data, so nothing is allocated
+	//
+	class TioDataText : boost::noncopyable
 	{
-		if(!key && !value && !metadata)
-			return;
+		char buffer_[32];
+		const char* data_;
+		size_t size_;
 
-		stringstream buffer;
-		string keyString, valueString, metadataString;
+	public:
+		explicit TioDataText(const TioData& data)
+			: data_(buffer_), size_(0)
+		{
+			std::to_chars_result result;
 
-		const TioData* data[] = {&key, &value, &metadata};
-		const char* names[] = {"key", "value", "metadata"};
-		string* strings[] = {&keyString, &valueString, &metadataString};
+			switch(data.GetDataType())
+			{
+			case TioData::Int:
+				result = std::to_chars(buffer_, buffer_ + sizeof(buffer_), data.AsInt());
+				size_ = result.ptr - buffer_;
+				break;
+			case TioData::Double:
+				result = std::to_chars(buffer_, buffer_ + sizeof(buffer_), data.AsDouble(), std::chars_format::general, 6);
+				size_ = result.ptr - buffer_;
+				break;
+			case TioData::String:
+				data_ = static_cast<const char*>(data.AsRaw());
+				size_ = data.GetSize();
+				break;
+			default:
+				break;
+			}
+		}
 
-		for(int a = 0 ; a < 3 ; a++)
+		const char* data() const
 		{
-			const TioData* currentData = data[a];
-			string* currentString = strings[a];
-			const char* currentName = names[a];
+			return data_;
+		}
 
-			if(!currentData || currentData->Empty())
-				continue;
+		size_t size() const
+		{
+			return size_;
+		}
+	};
 
-			buffer.str("");
+	inline const char* GetDataTypeName(const TioData& data)
+	{
+		switch(data.GetDataType())
+		{
+		case TioData::Int: return "int";
+		case TioData::Double: return "double";
+		case TioData::String: return "string";
+		default: return "INTERNAL_ERROR";
+		}
+	}
+
+	inline void AppendNumber(string* output, size_t number)
+	{
+		char buffer[24];
+		std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+		output->append(buffer, result.ptr);
+	}
+
+	//
+	// Appends " key <type> <size> value ...\r\n" and the field data lines. Null
+	// pointers and empty TioDatas are skipped
+	//
+	inline void AppendTextFields(string* output, const TioData* key, const TioData* value, const TioData* metadata)
+	{
+		const TioData* data[] = {key, value, metadata};
+		const char* names[] = {" key ", " value ", " metadata "};
 
-			buffer << *currentData;
+		std::optional<TioDataText> texts[3];
+		size_t dataSize = 0;
 
-			*currentString = buffer.str();
+		for(int a = 0 ; a < 3 ; a++)
+		{
+			if(!data[a] || data[a]->Empty())
+				continue;
 
-			stream << " " << currentName 
-				   << " " << GetDataTypeAsString(*currentData)
-				   << " " << currentString->length();
+			texts[a].emplace(*data[a]);
+			dataSize += texts[a]->size() + 2;
 		}
 
-		stream << "\r\n";
+		output->reserve(output->size() + dataSize + 64);
 
 		for(int a = 0 ; a < 3 ; a++)
 		{
-			const TioData* currentData = data[a];
-			const string* currentString = strings[a];
+			if(!texts[a])
+				continue;
+
+			output->append(names[a]);
+			output->append(GetDataTypeName(*data[a]));
+			output->push_back(' ');
+			AppendNumber(output, texts[a]->size());
+		}
 
-			if(!currentData || currentData->Empty())
+		output->append("\r\n", 2);
+
+		for(int a = 0 ; a < 3 ; a++)
+		{
+			if(!texts[a])
 				continue;
 
-			stream << *currentString << "\r\n";
+			output->append(texts[a]->data(), texts[a]->size());
+			output->append("\r\n", 2);
 		}
 	}
 
+	inline void SerializeData(const TioData& key, const TioData& value, const TioData& metadata, ostream& stream)
+	{
+		if(!key && !value && !metadata)
+			return;
+
+		string fields;
+
+		AppendTextFields(&fields, &key, &value, &metadata);
+
+		stream.write(fields.data(), static_cast<std::streamsize>(fields.size()));
+	}
+
 	inline void MakeEventAnswer(const string& eventName, unsigned int handle, 
 		const TioData& key, const TioData& value, const TioData& metadata, ostream& stream)
 	{
@@ -150,19 +227,39 @@ namespace tio
 		size_t size;
 	};
 
+	//
+	// the whole field must be the number, like lexical_cast did
+	//
+	template<typename T>
+	inline T ParseNumber(const char* begin, const char* end)
+	{
+		T value;
+
+		if(begin != end && *begin == '+')
+			++begin;
+
+		std::from_chars_result result = std::from_chars(begin, end, value);
+
+		if(result.ec != std::errc() || result.ptr != end)
+			throw std::invalid_argument("invalid number");
+
+		return value;
+	}
+
+	//
+	// Parses right from the received data, strings are copied only once, to the TioData
+	//
 	inline void SetTioData(TioData* tioData, const FieldInfo& fieldInfo, const unsigned char* buffer)
 	{
-		string str(buffer, buffer + fieldInfo.size);
+		const char* begin = reinterpret_cast<const char*>(buffer);
+		const char* end = begin + fieldInfo.size;
 
-		//
-		// TODO: replace lexical_cast with something else, it's very slow
-		//
-		if(fieldInfo.type == "int")
-			tioData->Set(lexical_cast<int>(str));
+		if(fieldInfo.type == "string")
+			tioData->Set(begin, fieldInfo.size);
+		else if(fieldInfo.type == "int")
+			tioData->Set(ParseNumber<int>(begin, end));
 		else if(fieldInfo.type == "double")
-			tioData->Set(lexical_cast<double>(str));
-		else if(fieldInfo.type == "string")
-			tioData->Set(str.c_str(), str.size());
+			tioData->Set(ParseNumber<double>(begin, end));
 		else
 			throw std::invalid_argument("invalid data type");
 	}
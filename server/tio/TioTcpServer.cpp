@@ -127,15 +127,19 @@ namespace tio
 	TioTcpServer::TioTcpServer(ContainerManager& containerManager, 
 			asio::io_service& io_service, 
 			const tcp::endpoint& endpoint,
-			const std::string& logFilePath) :
+			const std::string& logFilePath,
+			ServerShards* shards,
+			unsigned acceptorCount) :
 		containerManager_(containerManager),
-		acceptor_(io_service, endpoint),
 		io_service_(io_service),
 		lastSessionID_(0),
 		lastQueryID_(0),
-		serverPaused_(false)
+		lastDiffID_(0),
+		serverPaused_(false),
+		shards_(shards)
 	{
-		LoadDispatchMap();
+		CreateAcceptors(endpoint, acceptorCount);
+		LoadDispatchTable();
 		InitializeMetaContainers();
 
 		if(!logFilePath.empty())
@@ -204,53 +208,118 @@ namespace tio
 
 	unsigned int TioTcpServer::GenerateSessionId()
 	{
-		// TODO: sync
 		return ++lastSessionID_;
 	}
 
 	unsigned int TioTcpServer::GenerateDiffId()
 	{
-		// TODO: sync
 		return ++lastDiffID_;
 	}
 	
-	void TioTcpServer::DoAccept()
+#ifdef SO_REUSEPORT
+	typedef asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#endif
+
+	void TioTcpServer::CreateAcceptors(const tcp::endpoint& endpoint, unsigned acceptorCount)
 	{
-		shared_ptr<TioTcpSession> session(new TioTcpSession(io_service_, *this, GenerateSessionId()));
+#ifndef SO_REUSEPORT
+		if(acceptorCount > 1)
+		{
+			cout << "SO_REUSEPORT not supported, using a single acceptor" << endl;
+			acceptorCount = 1;
+		}
+#endif
+
+		if(acceptorCount == 0)
+			acceptorCount = 1;
+
+		for(unsigned a = 0 ; a < acceptorCount ; a++)
+		{
+			//
+			// on shard mode each acceptor will run on its own shard thread
+			//
+			asio::io_service& acceptorIoService = 
+				shards_ && acceptorCount > 1 ? shards_->GetShard(a).GetIoService() : io_service_;
+
+			shared_ptr<AcceptorInfo> acceptorInfo(new AcceptorInfo(acceptorIoService));
+			tcp::acceptor& acceptor = acceptorInfo->acceptor;
+
+			acceptor.open(endpoint.protocol());
+			acceptor.set_option(tcp::acceptor::reuse_address(true));
+
+#ifdef SO_REUSEPORT
+			if(acceptorCount > 1)
+				acceptor.set_option(reuse_port(true));
+#endif
+
+			acceptor.bind(endpoint);
+			acceptor.listen();
 
-		acceptor_.async_accept(session->GetSocket(),
-			[this, session](const error_code& err)
+			acceptors_.push_back(acceptorInfo);
+		}
+	}
+	
+	void TioTcpServer::DoAccept(shared_ptr<AcceptorInfo> acceptorInfo)
+	{
+		//
+		// on shard mode the session will live on one of the shards. If the
+		// acceptor is already running on a shard, we'll keep the session there
+		//
+		asio::io_service* sessionIoService = &io_service_;
+
+		if(shards_)
+		{
+			if(acceptors_.size() > 1)
+				sessionIoService = &acceptorInfo->io_service;
+			else
+				sessionIoService = &shards_->GetNextSessionShard().GetIoService();
+		}
+
+		shared_ptr<TioTcpSession> session(new TioTcpSession(*sessionIoService, *this, GenerateSessionId()));
+
+		acceptorInfo->acceptor.async_accept(session->GetSocket(),
+			[this, acceptorInfo, session](const error_code& err)
 			{
-				OnAccept(session, err);
+				OnAccept(acceptorInfo, session, err);
 			});
 	}
 
-	void TioTcpServer::OnAccept(shared_ptr<TioTcpSession> session, const error_code& err)
+	void TioTcpServer::OnAccept(shared_ptr<AcceptorInfo> acceptorInfo, shared_ptr<TioTcpSession> session, const error_code& err)
 	{
 		if(!!err)
 		{
 			throw err;
 		}
 
+		//
+		// accept the next one right now, the session setup below
+		// should not hold the other clients
+		//
+		DoAccept(acceptorInfo);
+
 		if(serverPaused_)
-		{
-			DoAccept();
 			return;
-		}
 
 		{
 			tio::recursive_mutex::scoped_lock lock(sessionsMutex_);
 			sessions_.insert(session);
 		}
 
-		metaContainers_.sessions->Insert(lexical_cast<string>(session->id()), TIONULL, TIONULL);
-
-		session->OnAccept();
+		//
+		// __meta__/sessions is updated from the session thread, so the
+		// meta container lock (and its subscribers) is not taken by the acceptor
+		//
+		auto sessions = metaContainers_.sessions;
 
-		DoAccept();
+		session->Dispatch(
+			[session, sessions]()
+			{
+				sessions->Insert(lexical_cast<string>(session->id()), TIONULL, TIONULL);
+				session->OnAccept();
+			});
 	}
 
-	shared_ptr<ITioContainer> TioTcpServer::GetContainerAndParametersFromRequest(const PR1_MESSAGE* message, shared_ptr<TioTcpSession> session, TioData* key, TioData* value, TioData* metadata)
+	shared_ptr<ITioContainer> TioTcpServer::GetContainerAndParametersFromRequest(const Pr1MessageView& message, shared_ptr<TioTcpSession> session, TioData* key, TioData* value, TioData* metadata)
 	{
 		int handle;
 
@@ -286,6 +355,9 @@ namespace tio
 		if(command == TIO_COMMAND_WAIT_AND_POP_KEY) return "TIO_COMMAND_WAIT_AND_POP_KEY";
 		if(command == TIO_COMMAND_PROPGET ) return "TIO_COMMAND_PROPGET ";
 		if(command == TIO_COMMAND_PROPSET) return "TIO_COMMAND_PROPSET";
+		if(command == TIO_COMMAND_PUSH_BACK_MANY) return "TIO_COMMAND_PUSH_BACK_MANY";
+		if(command == TIO_COMMAND_SET_MANY) return "TIO_COMMAND_SET_MANY";
+		if(command == TIO_COMMAND_GET_MANY) return "TIO_COMMAND_GET_MANY";
 
 		return "UNKNOWN";
 	}
@@ -293,13 +365,287 @@ namespace tio
 
 	
 
-	void TioTcpServer::OnBinaryCommand(shared_ptr<TioTcpSession> session, PR1_MESSAGE* message)
+	bool IsBinaryDataCommand(int command)
+	{
+		switch(command)
+		{
+		case TIO_COMMAND_GET:
+		case TIO_COMMAND_PROPGET:
+		case TIO_COMMAND_POP_FRONT:
+		case TIO_COMMAND_POP_BACK:
+		case TIO_COMMAND_PUSH_BACK:
+		case TIO_COMMAND_PUSH_FRONT:
+		case TIO_COMMAND_SET:
+		case TIO_COMMAND_INSERT:
+		case TIO_COMMAND_DELETE:
+		case TIO_COMMAND_CLEAR:
+		case TIO_COMMAND_PROPSET:
+		case TIO_COMMAND_COUNT:
+		case TIO_COMMAND_PUSH_BACK_MANY:
+		case TIO_COMMAND_SET_MANY:
+		case TIO_COMMAND_GET_MANY:
+			return true;
+		}
+
+		return false;
+	}
+
+	//
+	// Commands that only touch the container and answer the session. They don't
+	// use any session state, so they can run on the container owner shard
+	//
+	void TioTcpServer::OnBinaryDataCommand(shared_ptr<TioTcpSession> session, const Pr1MessageView& message, int command, shared_ptr<ITioContainer> container)
+	{
+		switch(command)
+		{
+		case TIO_COMMAND_GET:
+		case TIO_COMMAND_PROPGET:
+		{
+			TioData searchKey;
+
+			Pr1MessageGetField(message, MESSAGE_FIELD_ID_KEY, &searchKey);
+
+			TioData key, value, metadata;
+
+			if(command == TIO_COMMAND_GET)
+				container->GetRecord(searchKey, &key, &value, &metadata);
+			else if(command == TIO_COMMAND_PROPGET)
+			{
+				value = container->GetProperty(searchKey.AsSz());
+				key = searchKey;
+			}
+			else
+				throw std::runtime_error("INTERNAL ERROR");
+
+
+			session->SendBinaryAnswer(&key, &value, &metadata);
+		}
+		break;
+
+		case TIO_COMMAND_POP_FRONT:
+		case TIO_COMMAND_POP_BACK:
+		{
+			TioData key, value, metadata;
+
+			if(command == TIO_COMMAND_POP_BACK)
+				container->PopBack(&key, &value, &metadata);
+			else if(command == TIO_COMMAND_POP_FRONT)
+				container->PopFront(&key, &value, &metadata);
+			else
+				throw std::runtime_error("INTERNAL ERROR");
+
+			logger_.LogMessage(container.get(), message);
+
+			session->SendBinaryAnswer(&key, &value, &metadata);
+		}
+		break;
+
+		case TIO_COMMAND_PUSH_BACK:
+		case TIO_COMMAND_PUSH_FRONT:
+		case TIO_COMMAND_SET:
+		case TIO_COMMAND_INSERT:
+		case TIO_COMMAND_DELETE:
+		case TIO_COMMAND_CLEAR:
+		case TIO_COMMAND_PROPSET:
+		{
+			TioData key, value, metadata;
+
+			Pr1MessageGetHandleKeyValueAndMetadata(message, NULL, &key, &value, &metadata);
+
+			//
+			// the request is logged from the message, so the decoded
+			// data can be moved into the container
+			//
+			if(command == TIO_COMMAND_PUSH_BACK)
+				container->PushBack(key, std::move(value), std::move(metadata));
+			else if(command == TIO_COMMAND_PUSH_FRONT)
+				container->PushFront(key, std::move(value), std::move(metadata));
+			else if(command == TIO_COMMAND_SET)
+				container->Set(key, std::move(value), std::move(metadata));
+			else if(command == TIO_COMMAND_INSERT)
+				container->Insert(key, std::move(value), std::move(metadata));
+			else if(command == TIO_COMMAND_DELETE)
+				container->Delete(key, value, metadata);
+			else if(command == TIO_COMMAND_CLEAR)
+				container->Clear();
+			else if(command == TIO_COMMAND_PROPSET)
+			{
+				if(key.GetDataType() != TioData::String	|| value.GetDataType() != TioData::String)
+					throw std::runtime_error("properties key and value should be strings");
+
+				container->SetProperty(key.AsSz(), value.AsSz());
+			}
+			else
+				throw std::runtime_error("INTERNAL ERROR");
+
+			logger_.LogMessage(container.get(), message);
+
+			if(!Pr1CurrentRequest::IsNoReply())
+				session->SendBinaryAnswer();
+		}
+		break;
+
+		case TIO_COMMAND_COUNT:
+		{
+			int count = container->GetRecordCount();
+
+			shared_ptr<PR1_MESSAGE> answer = Pr1CreateAnswerMessage(NULL, NULL, NULL);
+			pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_VALUE, count);
+
+			session->SendBinaryMessage(answer);
+		}
+		break;
+
+		case TIO_COMMAND_PUSH_BACK_MANY:
+		case TIO_COMMAND_SET_MANY:
+		{
+			vector<TIO_RECORD> records;
+
+			Pr1MessageGetRecords(message, &records);
+
+			if(records.size() > TIO_MAX_RECORDS_PER_MESSAGE)
+				throw std::invalid_argument("too many records");
+
+			if(command == TIO_COMMAND_PUSH_BACK_MANY)
+			{
+				container->PushBackMany(records);
+				logger_.LogRecords(container.get(), "push_back", records);
+			}
+			else if(command == TIO_COMMAND_SET_MANY)
+			{
+				container->SetMany(records);
+				logger_.LogRecords(container.get(), "set", records);
+			}
+			else
+				throw std::runtime_error("INTERNAL ERROR");
+
+			if(Pr1CurrentRequest::IsNoReply())
+				break;
+
+			shared_ptr<PR1_MESSAGE> answer = Pr1CreateAnswerMessage(NULL, NULL, NULL);
+			pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_VALUE, static_cast<int>(records.size()));
+
+			session->SendBinaryMessage(answer);
+		}
+		break;
+
+		case TIO_COMMAND_GET_MANY:
+		{
+			vector<TioData> searchKeys;
+
+			for(const PR1_MESSAGE_FIELD_HEADER* field = message.GetNextField(NULL) ; field ; field = message.GetNextField(field))
+			{
+				if(field->field_id == MESSAGE_FIELD_ID_KEY)
+					searchKeys.push_back(Pr1MessageToCppTioData(field));
+			}
+
+			if(searchKeys.size() > TIO_MAX_RECORDS_PER_MESSAGE)
+				throw std::invalid_argument("too many records");
+
+			vector<TIO_RECORD> records;
+			vector<bool> found;
+
+			container->GetMany(searchKeys, &records, &found);
+
+			//
+			// every record starts with its key. Records that weren't found
+			// don't have the value field
+			//
+			shared_ptr<PR1_MESSAGE> answer = Pr1CreateAnswerMessage(NULL, NULL, NULL);
+
+			for(size_t a = 0 ; a < records.size() ; a++)
+			{
+				Pr1MessageAddField(answer.get(), MESSAGE_FIELD_ID_KEY, records[a].key);
+
+				if(!found[a])
+					continue;
+
+				Pr1MessageAddField(answer.get(), MESSAGE_FIELD_ID_VALUE, records[a].value);
+
+				if(records[a].metadata.GetDataType() != TioData::None)
+					Pr1MessageAddField(answer.get(), MESSAGE_FIELD_ID_METADATA, records[a].metadata);
+			}
+
+			session->SendBinaryMessage(answer);
+		}
+		break;
+
+		default:
+			throw std::runtime_error("INTERNAL ERROR");
+		}
+	}
+
+	TioTcpServer::DispatchResult TioTcpServer::DispatchBinaryCommandToOwner(shared_ptr<TioTcpSession> session, const Pr1MessageView& message)
+	{
+		if(!shards_)
+			return DispatchResult_NotDispatched;
+
+		int command = 0;
+		shared_ptr<ITioContainer> container;
+
+		try
+		{
+			if(Pr1MessageGetField(message, MESSAGE_FIELD_ID_COMMAND, &command) && IsBinaryDataCommand(command))
+				container = GetContainerAndParametersFromRequest(message, session, NULL, NULL, NULL);
+		}
+		catch(std::exception&)
+		{
+			//
+			// OnBinaryCommand will send the error, after the
+			// commands running on the owner
+			//
+		}
+
+		ServerShard* owner = container ? &shards_->GetContainerOwner(GetFullQualifiedName(container)) : NULL;
+
+		if(!session->CanRunAfterOwnerCommands(owner))
+			return DispatchResult_WaitOwnerCommands;
+
+		//
+		// we're already on the owner, the session can run it (OnBinaryCommand)
+		// and keep executing the messages it has buffered
+		//
+		if(!owner || owner->IsCurrentThread())
+			return DispatchResult_NotDispatched;
+
+		//
+		// the view points to the session receive buffer, the owner needs its own copy
+		//
+		const char* messageBuffer = static_cast<const char*>(message.GetBuffer());
+		auto messageCopy = std::make_shared<vector<char>>(messageBuffer, messageBuffer + message.GetSize());
+
+		auto run = [this, session, messageCopy, command, container]()
+		{
+			Pr1MessageView message;
+			message.Parse(messageCopy->data(), messageCopy->size());
+
+			Pr1CurrentRequest currentRequest(message);
+			TioTcpSession::RunningCommand runningCommand(session.get());
+
+			try
+			{
+				OnBinaryDataCommand(session, message, command, container);
+			}
+			catch(std::exception& ex)
+			{
+				session->SendBinaryErrorAnswer(TIO_ERROR_PROTOCOL, ex.what());
+			}
+
+			session->Dispatch([session](){ session->OnOwnerCommandDone(); });
+		};
+
+		session->OnOwnerCommandStarted(owner);
+
+		owner->Post(run);
+
+		return DispatchResult_Dispatched;
+	}
+
+	void TioTcpServer::OnBinaryCommand(shared_ptr<TioTcpSession> session, const Pr1MessageView& message)
 	{
 		bool b;
 		int command;
 
-		pr1_message_parse(message);
-
 		b = Pr1MessageGetField(message, MESSAGE_FIELD_ID_COMMAND, &command);
 
 		if(!b)
@@ -345,9 +691,8 @@ namespace tio
 						break;
 					}
 
-					shared_ptr<PR1_MESSAGE> answer = Pr1CreateMessage();
+					shared_ptr<PR1_MESSAGE> answer = Pr1CreateAnswerMessage();
 
-					pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_ANSWER);
 					pr1_message_add_field_string(answer.get(), MESSAGE_FIELD_ID_VALUE, payload.c_str());
 
 
@@ -387,9 +732,8 @@ namespace tio
 
 					unsigned int handle = session->RegisterContainer(name, container);
 
-					shared_ptr<PR1_MESSAGE> answer = Pr1CreateMessage();
+					shared_ptr<PR1_MESSAGE> answer = Pr1CreateAnswerMessage();
 
-					pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_ANSWER);
 					pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_HANDLE, handle);
 
 					logger_.LogMessage(container.get(), message);
@@ -418,48 +762,8 @@ namespace tio
 
 				case TIO_COMMAND_GET:
 				case TIO_COMMAND_PROPGET:
-				{
-					TioData searchKey;
-
-					shared_ptr<ITioContainer> container = GetContainerAndParametersFromRequest(message, session, &searchKey, NULL, NULL);
-
-					TioData key, value, metadata;
-
-					if(command == TIO_COMMAND_GET)
-						container->GetRecord(searchKey, &key, &value, &metadata);
-					else if(command == TIO_COMMAND_PROPGET)
-					{
-						value = container->GetProperty(searchKey.AsSz());
-						key = searchKey;
-					}
-					else
-						throw std::runtime_error("INTERNAL ERROR");
-
-
-					session->SendBinaryAnswer(&key, &value, &metadata);
-				}
-				break;
-
 				case TIO_COMMAND_POP_FRONT:
 				case TIO_COMMAND_POP_BACK:
-				{
-					shared_ptr<ITioContainer> container = GetContainerAndParametersFromRequest(message, session, NULL, NULL, NULL);
-
-					TioData key, value, metadata;
-
-					if(command == TIO_COMMAND_POP_BACK)
-						container->PopBack(&key, &value, &metadata);
-					else if(command == TIO_COMMAND_POP_FRONT)
-						container->PopFront(&key, &value, &metadata);
-					else
-						throw std::runtime_error("INTERNAL ERROR");
-
-					logger_.LogMessage(container.get(), message);
-
-					session->SendBinaryAnswer(&key, &value, &metadata);
-				}
-				break;
-
 				case TIO_COMMAND_PUSH_BACK:
 				case TIO_COMMAND_PUSH_FRONT:
 				case TIO_COMMAND_SET:
@@ -467,49 +771,14 @@ namespace tio
 				case TIO_COMMAND_DELETE:
 				case TIO_COMMAND_CLEAR:
 				case TIO_COMMAND_PROPSET:
-				{
-					TioData key, value, metadata;
-
-					shared_ptr<ITioContainer> container = GetContainerAndParametersFromRequest(message, session, &key, &value, &metadata);
-
-					if(command == TIO_COMMAND_PUSH_BACK)
-						container->PushBack(key, value, metadata);
-					else if(command == TIO_COMMAND_PUSH_FRONT)
-						container->PushFront(key, value, metadata);
-					else if(command == TIO_COMMAND_SET)
-						container->Set(key, value, metadata);
-					else if(command == TIO_COMMAND_INSERT)
-						container->Insert(key, value, metadata);
-					else if(command == TIO_COMMAND_DELETE)
-						container->Delete(key, value, metadata);
-					else if(command == TIO_COMMAND_CLEAR)
-						container->Clear();
-					else if(command == TIO_COMMAND_PROPSET)
-					{
-						if(key.GetDataType() != TioData::String	|| value.GetDataType() != TioData::String)
-							throw std::runtime_error("properties key and value should be strings");
-
-						container->SetProperty(key.AsSz(), value.AsSz());
-					}
-					else
-						throw std::runtime_error("INTERNAL ERROR");
-
-					logger_.LogMessage(container.get(), message);
-
-					session->SendBinaryAnswer();
-				}
-				break;
-
 				case TIO_COMMAND_COUNT:
+				case TIO_COMMAND_PUSH_BACK_MANY:
+				case TIO_COMMAND_SET_MANY:
+				case TIO_COMMAND_GET_MANY:
 				{
 					shared_ptr<ITioContainer> container = GetContainerAndParametersFromRequest(message, session, NULL, NULL, NULL);
 
-					int count = container->GetRecordCount();
-
-					shared_ptr<PR1_MESSAGE> answer = Pr1CreateAnswerMessage(NULL, NULL, NULL);
-					pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_VALUE, count);
-
-					session->SendBinaryMessage(answer);
+					OnBinaryDataCommand(session, message, command, container);
 				}
 				break;
 
@@ -686,11 +955,10 @@ namespace tio
 
 	void TioTcpServer::OnCommand(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session)
 	{
-		CommandFunctionMap::iterator i = dispatchMap_.find(cmd.GetCommand());
+		CommandCallbackFunction f = dispatchTable_[cmd.GetId()];
 
-		if(i != dispatchMap_.end())
+		if(f)
 		{
-			CommandCallbackFunction& f = i->second;
 
 			try
 			{
@@ -712,8 +980,8 @@ namespace tio
 			metaContainers_.sessionLastCommand->Set(
 				lexical_cast<string>(session->id()),
 				TioData(cmd.GetSource().c_str()),
-				cmd.GetDataBuffer()->GetSize() ? 
-					TioData(cmd.GetDataBuffer()->GetRawBuffer(), cmd.GetDataBuffer()->GetSize()) :
+				cmd.GetDataSize() ? 
+					TioData(cmd.GetData(), cmd.GetDataSize()) :
 					TIONULL);
 		}
 	}
@@ -722,63 +990,66 @@ namespace tio
 	//
 	// commands
 	//
-	void TioTcpServer::LoadDispatchMap()
+	void TioTcpServer::LoadDispatchTable()
 	{
-		dispatchMap_["ping"] = &TioTcpServer::OnCommand_Ping;
-		dispatchMap_["ver"] = &TioTcpServer::OnCommand_Version;
+		std::fill(std::begin(dispatchTable_), std::end(dispatchTable_), nullptr);
+
+		dispatchTable_[CommandId_Ping] = &TioTcpServer::OnCommand_Ping;
+		dispatchTable_[CommandId_Ver] = &TioTcpServer::OnCommand_Version;
+		dispatchTable_[CommandId_CompressionStats] = &TioTcpServer::OnCommand_CompressionStats;
 		
-		dispatchMap_["create"] = &TioTcpServer::OnCommand_CreateContainer_OpenContainer;
-		dispatchMap_["open"] = &TioTcpServer::OnCommand_CreateContainer_OpenContainer;
-		dispatchMap_["close"] = &TioTcpServer::OnCommand_CloseContainer;
+		dispatchTable_[CommandId_Create] = &TioTcpServer::OnCommand_CreateContainer_OpenContainer;
+		dispatchTable_[CommandId_Open] = &TioTcpServer::OnCommand_CreateContainer_OpenContainer;
+		dispatchTable_[CommandId_Close] = &TioTcpServer::OnCommand_CloseContainer;
 
-		dispatchMap_["delete_container"] = &TioTcpServer::OnCommand_DeleteContainer;
+		dispatchTable_[CommandId_DeleteContainer] = &TioTcpServer::OnCommand_DeleteContainer;
 
-		dispatchMap_["list_handles"] = &TioTcpServer::OnCommand_ListHandles;
+		dispatchTable_[CommandId_ListHandles] = &TioTcpServer::OnCommand_ListHandles;
 		
-		dispatchMap_["push_back"] = &TioTcpServer::OnAnyDataCommand;
-		dispatchMap_["push_front"] = &TioTcpServer::OnAnyDataCommand;
+		dispatchTable_[CommandId_PushBack] = &TioTcpServer::OnAnyDataCommand;
+		dispatchTable_[CommandId_PushFront] = &TioTcpServer::OnAnyDataCommand;
 		
-		dispatchMap_["pop_back"] = &TioTcpServer::OnCommand_Pop;
-		dispatchMap_["pop_front"] = &TioTcpServer::OnCommand_Pop;
+		dispatchTable_[CommandId_PopBack] = &TioTcpServer::OnCommand_Pop;
+		dispatchTable_[CommandId_PopFront] = &TioTcpServer::OnCommand_Pop;
 
-		dispatchMap_["modify"] = &TioTcpServer::OnModify;
+		dispatchTable_[CommandId_Modify] = &TioTcpServer::OnModify;
 
-		dispatchMap_["wnp_next"] = &TioTcpServer::OnCommand_WnpNext;
-		dispatchMap_["wnp_key"] = &TioTcpServer::OnCommand_WnpKey;
+		dispatchTable_[CommandId_WnpNext] = &TioTcpServer::OnCommand_WnpNext;
+		dispatchTable_[CommandId_WnpKey] = &TioTcpServer::OnCommand_WnpKey;
 		
-		dispatchMap_["set"] = &TioTcpServer::OnAnyDataCommand;
-		dispatchMap_["insert"] = &TioTcpServer::OnAnyDataCommand;
-		dispatchMap_["delete"] = &TioTcpServer::OnAnyDataCommand;
-		dispatchMap_["clear"] = &TioTcpServer::OnCommand_Clear;
+		dispatchTable_[CommandId_Set] = &TioTcpServer::OnAnyDataCommand;
+		dispatchTable_[CommandId_Insert] = &TioTcpServer::OnAnyDataCommand;
+		dispatchTable_[CommandId_Delete] = &TioTcpServer::OnAnyDataCommand;
+		dispatchTable_[CommandId_Clear] = &TioTcpServer::OnCommand_Clear;
 
-		dispatchMap_["get_property"] = &TioTcpServer::OnAnyDataCommand;
-		dispatchMap_["set_property"] = &TioTcpServer::OnAnyDataCommand;
+		dispatchTable_[CommandId_GetProperty] = &TioTcpServer::OnAnyDataCommand;
+		dispatchTable_[CommandId_SetProperty] = &TioTcpServer::OnAnyDataCommand;
 
-		dispatchMap_["get"] = &TioTcpServer::OnAnyDataCommand;
+		dispatchTable_[CommandId_Get] = &TioTcpServer::OnAnyDataCommand;
 
-		dispatchMap_["get_count"] = &TioTcpServer::OnCommand_GetRecordCount;
+		dispatchTable_[CommandId_GetCount] = &TioTcpServer::OnCommand_GetRecordCount;
 
-		dispatchMap_["subscribe"] = &TioTcpServer::OnCommand_SubscribeUnsubscribe;
-		dispatchMap_["unsubscribe"] = &TioTcpServer::OnCommand_SubscribeUnsubscribe;
+		dispatchTable_[CommandId_Subscribe] = &TioTcpServer::OnCommand_SubscribeUnsubscribe;
+		dispatchTable_[CommandId_Unsubscribe] = &TioTcpServer::OnCommand_SubscribeUnsubscribe;
 
-		dispatchMap_["command"] = &TioTcpServer::OnCommand_CustomCommand;
+		dispatchTable_[CommandId_Command] = &TioTcpServer::OnCommand_CustomCommand;
 		
-		dispatchMap_["auth"] = &TioTcpServer::OnCommand_Auth;
+		dispatchTable_[CommandId_Auth] = &TioTcpServer::OnCommand_Auth;
 
-		dispatchMap_["pause"] = &TioTcpServer::OnCommand_PauseResume;
-		dispatchMap_["resume"] = &TioTcpServer::OnCommand_PauseResume;
+		dispatchTable_[CommandId_Pause] = &TioTcpServer::OnCommand_PauseResume;
+		dispatchTable_[CommandId_Resume] = &TioTcpServer::OnCommand_PauseResume;
 
-		dispatchMap_["set_permission"] = &TioTcpServer::OnCommand_SetPermission;
+		dispatchTable_[CommandId_SetPermission] = &TioTcpServer::OnCommand_SetPermission;
 
-		dispatchMap_["query"] = &TioTcpServer::OnCommand_Query;
+		dispatchTable_[CommandId_Query] = &TioTcpServer::OnCommand_Query;
 
-		dispatchMap_["queryex"] = &TioTcpServer::OnCommand_QueryEx;
+		dispatchTable_[CommandId_QueryEx] = &TioTcpServer::OnCommand_QueryEx;
 		
-		dispatchMap_["diff_start"] = &TioTcpServer::OnCommand_Diff_Start;
-		dispatchMap_["diff"] = &TioTcpServer::OnCommand_Diff;
+		dispatchTable_[CommandId_DiffStart] = &TioTcpServer::OnCommand_Diff_Start;
+		dispatchTable_[CommandId_Diff] = &TioTcpServer::OnCommand_Diff;
 
-		dispatchMap_["group_add"] = &TioTcpServer::OnCommand_GroupAdd;
-		dispatchMap_["group_subscribe"] = &TioTcpServer::OnCommand_GroupSubscribe;
+		dispatchTable_[CommandId_GroupAdd] = &TioTcpServer::OnCommand_GroupAdd;
+		dispatchTable_[CommandId_GroupSubscribe] = &TioTcpServer::OnCommand_GroupSubscribe;
 
 	}
 
@@ -1647,7 +1918,7 @@ namespace tio
 				filterEnd = lexical_cast<int>(cmd.GetParameters()[2]);
 			}
 
-			if(cmd.GetCommand() == "subscribe")
+			if(cmd.GetId() == CommandId_Subscribe)
 			{
 				session->Subscribe(handle, start, filterEnd);
 
@@ -1655,7 +1926,7 @@ namespace tio
 				// we'll NOT send the answer, because session::subscribe already did
 				//
 			}
-			else if(cmd.GetCommand() == "unsubscribe")
+			else if(cmd.GetId() == CommandId_Unsubscribe)
 			{
 				session->Unsubscribe(handle);
 				MakeAnswer(success, answer);
@@ -1680,6 +1951,11 @@ namespace tio
 		MakeAnswer(success, answer, "0.1");
 	}
 
+	void TioTcpServer::OnCommand_CompressionStats(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session)
+	{
+		MakeAnswer(success, answer, Pr1Compression::GetStats());
+	}
+
 	bool TioTcpServer::CheckCommandAccess(const string& command, ostream& answer, shared_ptr<TioTcpSession> session)
 	{
 		if(auth_.CheckCommandAccess(command, session->GetTokens()) == Auth::allow)
@@ -1780,7 +2056,7 @@ namespace tio
 		// the current connection. It's useful when you want to load some
 		// data to the server without having everyone receiving the events
 		//
-		if(cmd.GetCommand() == "pause")
+		if(cmd.GetId() == CommandId_Pause)
 		{
 			for(auto i = sessions_.begin() ; i != sessions_.end() ; ++i)
 			{
@@ -1795,7 +2071,7 @@ namespace tio
 
 			serverPaused_ = true;
 		}
-		else if(cmd.GetCommand() == "resume")
+		else if(cmd.GetId() == CommandId_Resume)
 		{
 			serverPaused_ = false;
 		}
@@ -1895,7 +2171,7 @@ namespace tio
 		{
 			shared_ptr<ITioContainer> container;
 
-			if(cmd.GetCommand() == "create")
+			if(cmd.GetId() == CommandId_Create)
 			{
 				if(containerName.size() > 1 && containerName[0] == '_' && containerName[1] == '_')
 				{
@@ -2060,9 +2336,9 @@ namespace tio
 
 		try
 		{
-			unsigned int h;
+			const string& handleParameter = cmd.GetParameters()[0];
+			unsigned int h = ParseNumber<unsigned int>(handleParameter.data(), handleParameter.data() + handleParameter.size());
 
-			h = lexical_cast<unsigned int>(cmd.GetParameters()[0]);
 			*container = session->GetRegisteredContainer(h, containerName, containerType);
 
 			if(handle)
@@ -2080,8 +2356,8 @@ namespace tio
 		return ExtractFieldSet(
 			parameters.begin() + 1,
 			parameters.end(),
-			cmd.GetDataBuffer()->GetRawBuffer(),
-			cmd.GetDataBuffer()->GetSize(),
+			cmd.GetData(),
+			cmd.GetDataSize(),
 			key,
 			value,
 			metadata);
@@ -2097,7 +2373,7 @@ namespace tio
 				return;
 			}
 
-			BOOST_ASSERT(cmd.GetCommand() == "pop_back" || cmd.GetCommand() == "pop_front");
+			BOOST_ASSERT(cmd.GetId() == CommandId_PopBack || cmd.GetId() == CommandId_PopFront);
 
 			string containerName, containerType;
 
@@ -2112,9 +2388,9 @@ namespace tio
 
 			TioData key, value, metadata;
 			
-			if(cmd.GetCommand() == "pop_back")
+			if(cmd.GetId() == CommandId_PopBack)
 				container->PopBack(&key, &value, &metadata);
-			else if(cmd.GetCommand() == "pop_front")
+			else if(cmd.GetId() == CommandId_PopFront)
 				container->PopFront(&key, &value, &metadata);
 			
 			MakeDataAnswer(key, value, metadata, answer);
@@ -2354,8 +2630,14 @@ namespace tio
 				return;
 			}
 		
-			if(cmd.GetCommand() == "insert")
+			switch(cmd.GetId())
 			{
+			case CommandId_Insert:
+				//
+				// wait and pop needs the data after the write, so it's copied. A
+				// waiter can be registered while we write, so checking for one
+				// before moving would be a race. Copies share big strings anyway
+				//
 				container->Insert(key, value, metadata);
 				MakeAnswer(success, answer);
 
@@ -2365,10 +2647,8 @@ namespace tio
 				// we already sent the answer, so, time to return
 				//
 				return;
-			}
 
-			else if(cmd.GetCommand() == "set")
-			{
+			case CommandId_Set:
 				container->Set(key, value, metadata);
 
 				MakeAnswer(success, answer);
@@ -2379,28 +2659,22 @@ namespace tio
 				// we already sent the answer, so, time to return
 				//
 				return;
-			}
 
-			else if(cmd.GetCommand() == "pop_back")
-			{
+			case CommandId_PopBack:
 				container->PopBack(&key, &value, &metadata);
 
 				MakeDataAnswer(key, value, metadata, answer);
 
 				return;
-			}
 
-			else if(cmd.GetCommand() == "pop_front")
-			{
+			case CommandId_PopFront:
 				container->PopFront(&key, &value, &metadata);
 
 				MakeDataAnswer(key, value, metadata, answer);
 
 				return;
-			}
 
-			else if(cmd.GetCommand() == "push_back")
-			{
+			case CommandId_PushBack:
 				container->PushBack(key, value, metadata);
 
 				MakeAnswer(success, answer);
@@ -2411,26 +2685,26 @@ namespace tio
 				// we already sent the answer, so, time to return
 				//
 				return;
-			}
 
-			else if(cmd.GetCommand() == "push_front")
-				container->PushFront(key, value, metadata);
+			case CommandId_PushFront:
+				container->PushFront(key, std::move(value), std::move(metadata));
+				break;
 
-			else if(cmd.GetCommand() == "delete")
+			case CommandId_Delete:
 				container->Delete(key, value, metadata);
+				break;
 
-			else if(cmd.GetCommand() == "get")
-			{
-				TioData realKey;
-				container->GetRecord(key, &realKey, &value, &metadata);
+			case CommandId_Get:
+				{
+					TioData realKey;
+					container->GetRecord(key, &realKey, &value, &metadata);
 				
-				MakeDataAnswer(realKey.GetDataType() == TioData::None ? key : realKey, value, metadata, answer);
+					MakeDataAnswer(realKey.GetDataType() == TioData::None ? key : realKey, value, metadata, answer);
 
-				return;
-			}
+					return;
+				}
 
-			else if(cmd.GetCommand() == "set_property")
-			{
+			case CommandId_SetProperty:
 				try
 				{
 					container->SetProperty(key.AsSz(), value.AsSz());
@@ -2440,10 +2714,9 @@ namespace tio
 					MakeAnswer(error, answer, "key and value must be strings");
 					return;
 				}	
-			}
+				break;
 
-			else if(cmd.GetCommand() == "get_property")
-			{
+			case CommandId_GetProperty:
 				try
 				{
 					TioData value;
@@ -2456,10 +2729,12 @@ namespace tio
 				catch (std::exception&)
 				{
 					MakeAnswer(error, answer, "invalid key");
-					return;
 				}
 
 				return;
+
+			default:
+				break;
 			}
 		}
 		catch (std::exception& e)
@@ -2473,13 +2748,13 @@ namespace tio
 	
 	void TioTcpServer::Start()
 	{
-		DoAccept();
+		for(auto& acceptorInfo : acceptors_)
+			DoAccept(acceptorInfo);
 	}
 
-	string TioTcpServer::GetFullQualifiedName(shared_ptr<ITioContainer> container)
+	const string& TioTcpServer::GetFullQualifiedName(const shared_ptr<ITioContainer>& container)
 	{
-		return containerManager_.ResolveAlias(container->GetType())
-			+ "/" + container->GetName();
+		return container->GetFullQualifiedName();
 	}
 
 
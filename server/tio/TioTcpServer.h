@@ -22,6 +22,7 @@ Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
 #include "ContainerManager.h"
 #include "TioTcpProtocol.h"
 #include "TioTcpSession.h"
+#include "ServerShards.h"
 #include "auth.h"
 #include "logdb.h"
 
@@ -68,7 +69,7 @@ namespace tio
 
 			map<unsigned, SubscriberInfo> subscribers_;
 
-			void SendNewContainerToSubscriber(const shared_ptr<ITioContainer> container, const shared_ptr<TioTcpSession>& session, const string& start)
+			static void SendNewContainerToSubscriber(const string& groupName, const shared_ptr<ITioContainer> container, const shared_ptr<TioTcpSession>& session, const string& start)
 			{
 				if(!session->IsValid())
 					return;
@@ -84,7 +85,7 @@ namespace tio
 
 					Pr1MessageAddField(answer.get(), MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_NEW_GROUP_CONTAINER);
 					Pr1MessageAddField(answer.get(), MESSAGE_FIELD_ID_HANDLE, handle);
-					Pr1MessageAddField(answer.get(), MESSAGE_FIELD_ID_GROUP_NAME, groupName_);
+					Pr1MessageAddField(answer.get(), MESSAGE_FIELD_ID_GROUP_NAME, groupName);
 					Pr1MessageAddField(answer.get(), MESSAGE_FIELD_ID_CONTAINER_NAME, containerName);
 					Pr1MessageAddField(answer.get(), MESSAGE_FIELD_ID_CONTAINER_TYPE, container->GetType());
 
@@ -95,7 +96,7 @@ namespace tio
 				else
 				{
 					string answer = "group_container ";
-					answer += groupName_;
+					answer += groupName;
 					answer += " ";
 					answer += containerName;
 					answer += " ";
@@ -153,7 +154,16 @@ namespace tio
 					//
 					// TODO: respect start parameter, we need to save this with session ptr
 					//
-					SendNewContainerToSubscriber(container, session, subscriberInfo.start);
+					// The subscriber handle map belongs to the subscriber's strand
+					//
+					string groupName = groupName_;
+					string start = subscriberInfo.start;
+
+					session->Dispatch(
+						[groupName, container, session, start]()
+						{
+							SendNewContainerToSubscriber(groupName, container, session, start);
+						});
 				}
 			}
 
@@ -172,7 +182,7 @@ namespace tio
 
 				for(auto i = containers_.begin() ; i != containers_.end() ; ++i)
 				{
-					SendNewContainerToSubscriber(i->second, session, start);
+					SendNewContainerToSubscriber(groupName_, i->second, session, start);
 				}
 
 				subscribers_[session->id()] = SubscriberInfo(session, start);
@@ -221,6 +231,7 @@ namespace tio
 		typedef map<string, GroupInfo> GroupMap;
 
 		GroupMap groups_;
+		tio::recursive_mutex groupsMutex_;
 
 		GroupInfo* GetGroup(ContainerManager* containerManager, const string& groupName)
 		{
@@ -235,6 +246,7 @@ namespace tio
 	public:
 		void AddContainer(ContainerManager* containerManager, const string& groupName, shared_ptr<ITioContainer> container)
 		{
+			tio::recursive_mutex::scoped_lock lock(groupsMutex_);
 			GetGroup(containerManager, groupName)->AddContainer(container);
 		}
 
@@ -245,6 +257,7 @@ namespace tio
 		
 		bool SubscribeGroup(ContainerManager* containerManager, const string& groupName, const shared_ptr<TioTcpSession>& session, const string& start)
 		{
+			tio::recursive_mutex::scoped_lock lock(groupsMutex_);
 			GetGroup(containerManager, groupName)->Subscribe(session, start);
 			return true;
 		}
@@ -256,6 +269,7 @@ namespace tio
 		map<string, unsigned> globalContainerHandle_;
 		int lastGlobalHandle_;
 		logdb::File f_;
+		tio::recursive_mutex mutex_;
 
 		void RawLog(const string& what)
 		{
@@ -308,11 +322,13 @@ namespace tio
 			}
 		}
 
-		void LogMessage(ITioContainer* container, PR1_MESSAGE* message)
+		void LogMessage(ITioContainer* container, const Pr1MessageView& message)
 		{
 			if(!f_.IsValid())
 				return;
 
+			tio::recursive_mutex::scoped_lock lock(mutex_);
+
 			bool b;
 			int command;
 
@@ -465,6 +481,37 @@ namespace tio
 
 			RawLog(logLine);
 		}
+
+		//
+		// Batch commands are logged as one single record command per record,
+		// so the log format doesn't change
+		//
+		void LogRecords(ITioContainer* container, const char* commandName, const vector<TIO_RECORD>& records)
+		{
+			if(!f_.IsValid())
+				return;
+
+			tio::recursive_mutex::scoped_lock lock(mutex_);
+
+			unsigned& globalHandle = globalContainerHandle_[container->GetName()];
+
+			string logLine;
+
+			for(const TIO_RECORD& record : records)
+			{
+				logLine.append(",");
+				logLine.append(commandName);
+				logLine.append(",");
+				logLine.append(lexical_cast<string>(globalHandle));
+
+				SerializeTioData(&logLine, record.key);
+				SerializeTioData(&logLine, record.value);
+				SerializeTioData(&logLine, record.metadata);
+				logLine.append("\n");
+			}
+
+			RawLog(logLine);
+		}
 	};
 
 	
@@ -548,9 +595,9 @@ namespace tio
 		DiffSessions diffSessions_;
 		tio::recursive_mutex diffSessionsMutex_;
 
-		unsigned int lastSessionID_;
-		unsigned int lastQueryID_;
-		unsigned int lastDiffID_;
+		std::atomic<unsigned int> lastSessionID_;
+		std::atomic<unsigned int> lastQueryID_;
+		std::atomic<unsigned int> lastDiffID_;
 
 		typedef map< string, deque<NextPopperInfo> > NextPoppersMap;
 		NextPoppersMap nextPoppers_;
@@ -558,15 +605,39 @@ namespace tio
 
 		typedef void (tio::TioTcpServer::* CommandCallbackFunction)(tio::Command &,std::ostream &,size_t *,std::shared_ptr<TioTcpSession>);
 
-		typedef std::map<string, CommandCallbackFunction> CommandFunctionMap;
-		CommandFunctionMap dispatchMap_;
+		//
+		// indexed by the command id, null for unknown commands
+		//
+		CommandCallbackFunction dispatchTable_[CommandId_Count];
 
 		Auth auth_;
 
-		bool serverPaused_;
+		std::atomic<bool> serverPaused_;
 		
-		tcp::acceptor acceptor_;
 		asio::io_service& io_service_;
+
+		struct AcceptorInfo : boost::noncopyable
+		{
+			AcceptorInfo(asio::io_service& io_service)
+				: io_service(io_service)
+				, acceptor(io_service)
+			{
+			}
+
+			asio::io_service& io_service;
+			tcp::acceptor acceptor;
+		};
+
+		//
+		// With more than one acceptor they're all bound to the same port using
+		// SO_REUSEPORT, so the kernel will balance the new connections
+		//
+		vector< shared_ptr<AcceptorInfo> > acceptors_;
+
+		//
+		// NULL unless running with --owner-threads
+		//
+		ServerShards* shards_;
 		
 		typedef std::set< shared_ptr<TioTcpSession> > SessionsSet;
 		SessionsSet sessions_;
@@ -580,15 +651,16 @@ namespace tio
 
 		GroupManager groupManager_;
 				
-		void DoAccept();
-		void OnAccept(shared_ptr<TioTcpSession> client, const error_code& err);
+		void CreateAcceptors(const tcp::endpoint& endpoint, unsigned acceptorCount);
+		void DoAccept(shared_ptr<AcceptorInfo> acceptorInfo);
+		void OnAccept(shared_ptr<AcceptorInfo> acceptorInfo, shared_ptr<TioTcpSession> client, const error_code& err);
 		
 		pair<shared_ptr<ITioContainer>, int> GetRecordBySpec(const string& spec, shared_ptr<TioTcpSession> session);
 
 		size_t ParseDataCommand(Command& cmd, string* containerType, string* containerName, shared_ptr<ITioContainer>* container, 
 			TioData* key, TioData* value, TioData* metadata, shared_ptr<TioTcpSession> session, unsigned int* handle = NULL);
 
-		void LoadDispatchMap();
+		void LoadDispatchTable();
 
 		void SendResultSet(shared_ptr<TioTcpSession> session, shared_ptr<ITioResultSet> resultSet);
 
@@ -604,6 +676,7 @@ namespace tio
 
 		void OnCommand_Ping(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session);
 		void OnCommand_Version(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session);
+		void OnCommand_CompressionStats(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session);
 		
 		void OnCommand_CreateContainer_OpenContainer(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session);
 		void OnCommand_CloseContainer(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session);
@@ -622,7 +695,7 @@ namespace tio
 		void OnCommand_WnpNext(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session);
 		void OnCommand_WnpKey(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session);
 
-		string GetFullQualifiedName(shared_ptr<ITioContainer> container);
+		const string& GetFullQualifiedName(const shared_ptr<ITioContainer>& container);
 
 		void OnCommand_PauseResume(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session);
 
@@ -644,7 +717,9 @@ namespace tio
 
 		void InitializeMetaContainers();
 
-		shared_ptr<ITioContainer> GetContainerAndParametersFromRequest(const PR1_MESSAGE* message, shared_ptr<TioTcpSession> session, TioData* key, TioData* value, TioData* metadata);
+		void OnBinaryDataCommand(shared_ptr<TioTcpSession> session, const Pr1MessageView& message, int command, shared_ptr<ITioContainer> container);
+
+		shared_ptr<ITioContainer> GetContainerAndParametersFromRequest(const Pr1MessageView& message, shared_ptr<TioTcpSession> session, TioData* key, TioData* value, TioData* metadata);
 
 		unsigned int GenerateSessionId();
 		unsigned int GenerateDiffId();
@@ -655,13 +730,30 @@ namespace tio
 			const TioData& key, const TioData& value, const TioData& metadata);
 
 	public:
-		TioTcpServer(ContainerManager& containerManager,asio::io_service& io_service, const tcp::endpoint& endpoint, const std::string& logFilePath);
+		TioTcpServer(ContainerManager& containerManager,asio::io_service& io_service, const tcp::endpoint& endpoint, const std::string& logFilePath,
+			ServerShards* shards = NULL, unsigned acceptorCount = 1);
 		void OnClientFailed(shared_ptr<TioTcpSession> client, const error_code& err);
 		void OnCommand(Command& cmd, ostream& answer, size_t* moreDataSize, shared_ptr<TioTcpSession> session);
 
 		void PostCallback(function<void()> callback);
 		
-		void OnBinaryCommand(shared_ptr<TioTcpSession> session, PR1_MESSAGE* message);
+		void OnBinaryCommand(shared_ptr<TioTcpSession> session, const Pr1MessageView& message);
+
+		enum DispatchResult
+		{
+			DispatchResult_NotDispatched,		// must be handled by OnBinaryCommand
+			DispatchResult_Dispatched,			// will be answered by the owner, session can keep reading
+			DispatchResult_WaitOwnerCommands	// not executed, session must stop reading until its owner commands are done
+		};
+
+		//
+		// In shard mode, runs data commands on the thread that owns the container.
+		// The owner runs the commands it gets in order, so the session keeps reading
+		// while data commands for the same container owner are running. Any other
+		// command (another owner, a query, subscribe, open, ...) waits until they're
+		// done, so it doesn't overtake them
+		//
+		DispatchResult DispatchBinaryCommandToOwner(shared_ptr<TioTcpSession> session, const Pr1MessageView& message);
 
 		void Start();
 
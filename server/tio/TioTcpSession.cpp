@@ -58,9 +58,94 @@ namespace tio
 
 	std::ostream& TioTcpSession::logstream_ = std::cout;
 	
+	unsigned int Pr1Compression::threshold = TIO_DEFAULT_COMPRESSION_THRESHOLD;
+
+	std::atomic<uint64_t> Pr1Compression::compressedMessages(0);
+	std::atomic<uint64_t> Pr1Compression::originalBytes(0);
+	std::atomic<uint64_t> Pr1Compression::compressedBytes(0);
+	std::atomic<uint64_t> Pr1Compression::compressMicroseconds(0);
+	std::atomic<uint64_t> Pr1Compression::decompressedMessages(0);
+	std::atomic<uint64_t> Pr1Compression::decompressMicroseconds(0);
+
+	static uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - start).count());
+	}
+
+	shared_ptr<PR1_MESSAGE> Pr1Compression::Compress(const void* pr1Buffer, unsigned int bufferSize)
+	{
+		if(threshold == 0 || bufferSize < threshold)
+			return shared_ptr<PR1_MESSAGE>();
+
+		auto start = std::chrono::steady_clock::now();
+
+		shared_ptr<PR1_MESSAGE> compressed = Pr1CreateMessage();
+
+		if(pr1_compress_fields(pr1Buffer, threshold, compressed.get()) <= 0)
+			return shared_ptr<PR1_MESSAGE>();
+
+		compressMicroseconds += MicrosecondsSince(start);
+		compressedMessages++;
+		originalBytes += bufferSize;
+		compressedBytes += stream_buffer_space_used(compressed->stream_buffer);
+
+		return compressed;
+	}
+
+	shared_ptr<PR1_MESSAGE> Pr1Compression::Decompress(const void* pr1Buffer)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		shared_ptr<PR1_MESSAGE> decompressed = Pr1CreateMessage();
+
+		int result = pr1_decompress_fields(pr1Buffer, decompressed.get());
+
+		if(TIO_FAILED(result))
+			throw std::invalid_argument("invalid compressed field");
+
+		if(result == 0)
+			return shared_ptr<PR1_MESSAGE>();
+
+		decompressMicroseconds += MicrosecondsSince(start);
+		decompressedMessages++;
+
+		return decompressed;
+	}
+
+	string Pr1Compression::GetStats()
+	{
+		stringstream stats;
+
+		stats << "threshold=" << threshold
+			<< " compressed_messages=" << compressedMessages
+			<< " original_bytes=" << originalBytes
+			<< " compressed_bytes=" << compressedBytes
+			<< " compress_us=" << compressMicroseconds
+			<< " decompressed_messages=" << decompressedMessages
+			<< " decompress_us=" << decompressMicroseconds;
+
+		return stats.str();
+	}
+
+	//
+	// Replaces the message by one with the big string fields compressed, if it has any
+	//
+	static void Pr1CompressMessage(shared_ptr<PR1_MESSAGE>* message)
+	{
+		void* buffer;
+		unsigned int bufferSize;
+
+		pr1_message_get_buffer(message->get(), &buffer, &bufferSize);
+
+		if(shared_ptr<PR1_MESSAGE> compressed = Pr1Compression::Compress(buffer, bufferSize))
+			*message = std::move(compressed);
+	}
+
 	TioTcpSession::TioTcpSession(asio::io_service& io_service, TioTcpServer& server, unsigned int id) :
 		io_service_(io_service),
 		socket_(io_service),
+		strand_(io_service),
 		server_(server),
 		lastHandle_(0),
 		valid_(true),
@@ -68,7 +153,14 @@ namespace tio
 		maxPendingSendingSize_(0),
 		sentBytes_(0),
 		id_(id),
-		binaryProtocol_(false)
+		binaryProtocol_(false),
+		compactProtocol_(false),
+		compressionEnabled_(false),
+		textWriteRunning_(false),
+		executingBinaryBatch_(false),
+		ownerCommands_(0),
+		ownerCommandsShard_(NULL),
+		waitingOwnerCommands_(false)
 	{
 		return;
 	}
@@ -164,6 +256,71 @@ namespace tio
 		return binaryProtocol_;
 	}
 
+	void TioTcpSession::Dispatch(function<void()> callback)
+	{
+		strand_.dispatch(callback);
+	}
+
+	static TioTcpSession*& CurrentCommandSession()
+	{
+		static thread_local TioTcpSession* session = NULL;
+		return session;
+	}
+
+	TioTcpSession::RunningCommand::RunningCommand(TioTcpSession* session)
+		: previous_(CurrentCommandSession())
+	{
+		CurrentCommandSession() = session;
+	}
+
+	TioTcpSession::RunningCommand::~RunningCommand()
+	{
+		CurrentCommandSession() = previous_;
+	}
+
+	bool TioTcpSession::IsRunningCommandInThisThread() const
+	{
+		return CurrentCommandSession() == this;
+	}
+
+	//
+	// owner is NULL for commands that run on the session (not a data command,
+	// or an invalid one). Only commands for the owner that is already running
+	// ours can go before it's done
+	//
+	bool TioTcpSession::CanRunAfterOwnerCommands(const ServerShard* owner) const
+	{
+		BOOST_ASSERT(strand_.running_in_this_thread());
+
+		return ownerCommands_ == 0 || (owner && owner == ownerCommandsShard_);
+	}
+
+	void TioTcpSession::OnOwnerCommandStarted(const ServerShard* owner)
+	{
+		BOOST_ASSERT(strand_.running_in_this_thread());
+		BOOST_ASSERT(CanRunAfterOwnerCommands(owner));
+
+		ownerCommands_++;
+		ownerCommandsShard_ = owner;
+	}
+
+	void TioTcpSession::OnOwnerCommandDone()
+	{
+		BOOST_ASSERT(strand_.running_in_this_thread());
+		BOOST_ASSERT(ownerCommands_ > 0);
+
+		if(--ownerCommands_ != 0)
+			return;
+
+		ownerCommandsShard_ = NULL;
+
+		if(waitingOwnerCommands_)
+		{
+			waitingOwnerCommands_ = false;
+			ReadBinaryProtocolMessage();
+		}
+	}
+
 	tcp::socket& TioTcpSession::GetSocket()
 	{
 		return socket_;
@@ -179,25 +336,23 @@ namespace tio
 	}
 
 	
-	void TioTcpSession::OnBinaryProtocolMessage(PR1_MESSAGE* message, const error_code& err)
+	void TioTcpSession::OnPopEvent(unsigned int handle, const string& eventName, const TioData& key, const TioData& value, const TioData& metadata)
 	{
-		// this thing will delete the pointer
-		shared_ptr<PR1_MESSAGE> messageHolder(message, &pr1_message_delete);
-
-		if(CheckError(err))
-			return;
-
-		server_.OnBinaryCommand(shared_from_this(), message);
+		//
+		// We're called with the container lock held, probably from another
+		// session's thread. The event is queued now to keep the container order,
+		// but the poppers map belongs to our strand
+		//
+		auto shared_this = shared_from_this();
 
-		ReadBinaryProtocolMessage();
-	}
+		Dispatch(
+			[shared_this, handle]()
+			{
+				WaitAndPopNextMap::iterator i = shared_this->poppers_.find(handle);
 
-	void TioTcpSession::OnPopEvent(unsigned int handle, const string& eventName, const TioData& key, const TioData& value, const TioData& metadata)
-	{
-		WaitAndPopNextMap::iterator i = poppers_.find(handle);
-		
-		if(i != poppers_.end())
-			poppers_.erase(i);
+				if(i != shared_this->poppers_.end())
+					shared_this->poppers_.erase(i);
+			});
 
 		if(binaryProtocol_)
 			SendBinaryEvent(handle, key, value, metadata, eventName);
@@ -236,41 +391,209 @@ namespace tio
 
 	}
 
-	void TioTcpSession::OnBinaryProtocolMessageHeader(shared_ptr<PR1_MESSAGE_HEADER> header, const error_code& err)
+	//
+	// Parses the first message in buf_. Returns false if it's not complete. PR1 messages
+	// are used right from the receive buffer, PR2 ones are decoded to pr2Request_
+	//
+	bool TioTcpSession::ParseBufferedBinaryMessage(Pr1MessageView* message, size_t* messageSize, bool* parsed, size_t* missingBytes)
 	{
-		if(CheckError(err))
-			return;
+		const char* data = asio::buffer_cast<const char*>(buf_.data());
+		size_t size = buf_.size();
+
+		if(compactProtocol_)
+		{
+			unsigned int bodySize;
+			int prefixSize = pr2_read_message_size(data, 
+				static_cast<unsigned int>(std::min<size_t>(size, PR2_MAX_VARINT_SIZE)), &bodySize);
+
+			if(prefixSize == 0)
+			{
+				*missingBytes = 1;
+				return false;
+			}
+
+			//
+			// we can't know where the next message starts
+			//
+			if(prefixSize < 0)
+			{
+				*messageSize = size;
+				*parsed = false;
+				return true;
+			}
+
+			if(size - prefixSize < bodySize)
+			{
+				*missingBytes = prefixSize + bodySize - size;
+				return false;
+			}
+
+			*messageSize = prefixSize + bodySize;
+
+			if(!pr2Request_)
+				pr2Request_ = Pr1CreateMessage();
+			else
+				pr1_message_reset(pr2Request_.get());
+
+			*parsed = false;
+
+			if(pr2_decode_message(data + prefixSize, bodySize, pr2Request_.get()) == TIO_SUCCESS)
+			{
+				void* buffer;
+				unsigned int bufferSize;
+
+				pr1_message_get_buffer(pr2Request_.get(), &buffer, &bufferSize);
+
+				*parsed = message->Parse(buffer, bufferSize) && DecompressBinaryMessage(message);
+			}
+
+			return true;
+		}
+
+		PR1_MESSAGE_HEADER header;
+
+		if(size < sizeof(PR1_MESSAGE_HEADER))
+		{
+			*missingBytes = sizeof(PR1_MESSAGE_HEADER) - size;
+			return false;
+		}
+
+		memcpy(&header, data, sizeof(PR1_MESSAGE_HEADER));
+
+		if(size - sizeof(PR1_MESSAGE_HEADER) < header.message_size)
+		{
+			*missingBytes = sizeof(PR1_MESSAGE_HEADER) + header.message_size - size;
+			return false;
+		}
+
+		*messageSize = sizeof(PR1_MESSAGE_HEADER) + header.message_size;
+		*parsed = message->Parse(data, *messageSize) && DecompressBinaryMessage(message);
+
+		return true;
+	}
+
+	//
+	// If the message has compressed fields, the view is changed to point to
+	// decompressedRequest_, with them expanded. Returns false if they're invalid
+	//
+	bool TioTcpSession::DecompressBinaryMessage(Pr1MessageView* message)
+	{
+		if(!compressionEnabled_)
+			return true;
+
+		try
+		{
+			decompressedRequest_ = Pr1Compression::Decompress(message->GetBuffer());
+		}
+		catch(std::exception&)
+		{
+			return false;
+		}
+
+		if(!decompressedRequest_)
+			return true;
 
 		void* buffer;
-		PR1_MESSAGE* message;
+		unsigned int bufferSize;
 
-		message = pr1_message_new_get_buffer_for_receive(header.get(), &buffer);
+		pr1_message_get_buffer(decompressedRequest_.get(), &buffer, &bufferSize);
 
-		auto shared_this = shared_from_this();
+		return message->Parse(buffer, bufferSize);
+	}
 
-		asio::async_read(
-					socket_, 
-					asio::buffer(buffer, header->message_size),
-					[shared_this, message](const error_code& err, size_t read)
-					{
-						shared_this->OnBinaryProtocolMessage(message, err);
-						
-					});
+	//
+	// Executes every complete message in buf_. Returns false if we need more
+	// data, or true if a message must wait for the commands running on the
+	// container owner shard, and OnOwnerCommandDone will call
+	// ReadBinaryProtocolMessage when they're done
+	//
+	bool TioTcpSession::ExecuteBufferedBinaryMessages(size_t* missingBytes)
+	{
+		for(;;)
+		{
+			if(!valid_)
+				return true;
+
+			Pr1MessageView message;
+			size_t messageSize;
+			bool parsed;
+
+			if(!ParseBufferedBinaryMessage(&message, &messageSize, &parsed, missingBytes))
+				return false;
+
+			if(!parsed)
+			{
+				buf_.consume(messageSize);
+				SendBinaryErrorAnswer(TIO_ERROR_PROTOCOL, "invalid message");
+				continue;
+			}
+
+			Pr1CurrentRequest currentRequest(message);
+			RunningCommand runningCommand(this);
+
+			switch(server_.DispatchBinaryCommandToOwner(shared_from_this(), message))
+			{
+			case TioTcpServer::DispatchResult_NotDispatched:
+				server_.OnBinaryCommand(shared_from_this(), message);
+				break;
+			case TioTcpServer::DispatchResult_WaitOwnerCommands:
+				//
+				// the message stays in buf_, OnOwnerCommandDone
+				// will execute it
+				//
+				waitingOwnerCommands_ = true;
+				return true;
+			case TioTcpServer::DispatchResult_Dispatched:
+				break;
+			}
+
+			buf_.consume(messageSize);
+		}
 	}
 
+	//
+	// Pipelined clients send lots of messages at once, so we read as much as
+	// we can and execute all complete messages before sending the answers. buf_
+	// can have binary data already, if the client didn't wait for the
+	// "protocol binary" answer
+	//
 	void TioTcpSession::ReadBinaryProtocolMessage()
 	{
-		shared_ptr<PR1_MESSAGE_HEADER> header(new PR1_MESSAGE_HEADER);
+		static const size_t READ_CHUNK_SIZE = 64 * 1024;
+
+		size_t missingBytes = 0;
+		bool waitingOwner;
+
+		executingBinaryBatch_ = true;
+
+		waitingOwner = ExecuteBufferedBinaryMessages(&missingBytes);
+
+		executingBinaryBatch_ = false;
+
+		SendPendingBinaryData();
+
+		if(waitingOwner)
+			return;
 
 		auto shared_this = shared_from_this();
 
-		asio::async_read(
-					socket_, 
-					asio::buffer(header.get(), sizeof(PR1_MESSAGE_HEADER)),
-					[shared_this, header](const error_code& err, size_t read)
-					{
-						shared_this->OnBinaryProtocolMessageHeader(header, err);
-					});
+		socket_.async_read_some(
+					buf_.prepare(missingBytes > READ_CHUNK_SIZE ? missingBytes : READ_CHUNK_SIZE),
+					strand_.wrap(
+						[shared_this](const error_code& err, size_t read)
+						{
+							shared_this->OnBinaryProtocolData(err, read);
+						}));
+	}
+
+	void TioTcpSession::OnBinaryProtocolData(const error_code& err, size_t read)
+	{
+		if(CheckError(err))
+			return;
+
+		buf_.commit(read);
+
+		ReadBinaryProtocolMessage();
 	}
 
 	void TioTcpSession::ReadCommand()
@@ -280,10 +603,11 @@ namespace tio
 		auto shared_this = shared_from_this();
 
 		asio::async_read_until(socket_, buf_, '\n', 
-			[shared_this](const error_code& err, size_t read)
-			{
-				shared_this->OnReadCommand(err, read);
-			});
+			strand_.wrap(
+				[shared_this](const error_code& err, size_t read)
+				{
+					shared_this->OnReadCommand(err, read);
+				}));
 	}
 
 	void TioTcpSession::OnReadCommand(const error_code& err, size_t read)
@@ -291,19 +615,21 @@ namespace tio
 		if(CheckError(err))
 			return;
 
-		string str;
 		stringstream answer;
 		bool moreDataToRead = false;
 		size_t moreDataSize = 0;
-		istream stream (&buf_);
 
-		getline(stream, str);
+		//
+		// the line is parsed right from the receive buffer, without the \n
+		//
+		std::string_view str(asio::buffer_cast<const char*>(buf_.data()), read - 1);
 
 		//
 		// can happen if client send binary data
 		//
 		if(str.empty())
 		{
+			buf_.consume(read);
 			ReadCommand();
 			return;
 		}
@@ -311,34 +637,48 @@ namespace tio
 		//
 		// delete last \r if any
 		//
-		if(*(str.end() - 1) == '\r')
-			str.erase(str.end() - 1);
+		if(str.back() == '\r')
+			str.remove_suffix(1);
 
 		BOOST_ASSERT(currentCommand_.GetCommand().empty());
 		
-		currentCommand_.Parse(str.c_str());
+		currentCommand_.Parse(str);
+
+		buf_.consume(read);
 
 		//
 		// Check for protocol change. 
 		//
-		if(currentCommand_.GetCommand() == "protocol")
+		if(currentCommand_.GetId() == CommandId_Protocol)
 		{
 			const Command::Parameters& parameters = currentCommand_.GetParameters();
 
-			if(parameters.size() == 1 && parameters[0] == "binary")
+			if((parameters.size() == 1 || (parameters.size() == 2 && parameters[1] == "compressed")) && 
+				(parameters[0] == "binary" || parameters[0] == "compact"))
 			{
-				SendAnswer("going binary");
+				compactProtocol_ = parameters[0] == "compact";
+				compressionEnabled_ = parameters.size() == 2;
+				SendAnswer(compactProtocol_ ? "going compact" : "going binary");
 				binaryProtocol_ = true;
-				ReadBinaryProtocolMessage();
+
+				//
+				// the answer write is posted, the binary answers must go after it
+				//
+				auto shared_this = shared_from_this();
+				strand_.post([shared_this](){ shared_this->ReadBinaryProtocolMessage(); });
+
 				return;
 			}
 		}
 
 #ifdef _TIO_DEBUG
-		cout << "<< " << str << endl;
+		cout << "<< " << currentCommand_.GetSource() << endl;
 #endif
 
-		server_.OnCommand(currentCommand_, answer, &moreDataSize, shared_from_this());
+		{
+			RunningCommand runningCommand(this);
+			server_.OnCommand(currentCommand_, answer, &moreDataSize, shared_from_this());
+		}
 		
 		if(moreDataSize)
 		{
@@ -348,7 +688,7 @@ namespace tio
 			{
 				auto shared_this = shared_from_this();
 
-				io_service_.post(
+				strand_.post(
 					[shared_this, moreDataSize]()
 					{
 						shared_this->OnCommandData(moreDataSize, boost::system::error_code(), moreDataSize);
@@ -360,10 +700,11 @@ namespace tio
 
 				asio::async_read(
 					socket_, buf_, asio::transfer_at_least(moreDataSize - buf_.size()),
-					[shared_this, moreDataSize](const error_code& err, size_t read)
-					{
-						shared_this->OnCommandData(moreDataSize, err, read);
-					});
+					strand_.wrap(
+						[shared_this, moreDataSize](const error_code& err, size_t read)
+						{
+							shared_this->OnCommandData(moreDataSize, err, read);
+						}));
 			}
 
 			moreDataToRead = true;
@@ -397,14 +738,18 @@ namespace tio
 		size_t moreDataSize = 0;
 
 		//
-		// TODO: avoid this copy
+		// the data is parsed right from the receive buffer, so it
+		// can only be consumed after the command is executed
 		//
-		shared_ptr<tio::Buffer>& dataBuffer = currentCommand_.GetDataBuffer();
-		dataBuffer->EnsureMinSize(dataSize);
+		currentCommand_.SetData(asio::buffer_cast<const char*>(buf_.data()), dataSize);
 
-		buf_.sgetn((char*)dataBuffer->GetRawBuffer(), static_cast<std::streamsize>(dataSize));
+		{
+			RunningCommand runningCommand(this);
+			server_.OnCommand(currentCommand_, answer, &moreDataSize, shared_from_this());
+		}
 
-		server_.OnCommand(currentCommand_, answer, &moreDataSize, shared_from_this());
+		currentCommand_.SetData(NULL, 0);
+		buf_.consume(dataSize);
 
 		BOOST_ASSERT(moreDataSize == 0);
 
@@ -433,56 +778,59 @@ namespace tio
 	}
 
 
-	string TioDataToString(const TioData& data)
+	//
+	// events and query items never had empty strings fields
+	//
+	static const TioData* NonEmptyTextField(const TioData& data)
 	{
-		if(!data)
-			return string();
+		if(!data || (data.GetDataType() == TioData::String && data.GetSize() == 0))
+			return NULL;
 
-		stringstream stream;
-
-		stream << data;
-
-		return stream.str();
+		return &data;
 	}
 
-	void TioTcpSession::SendTextEvent(unsigned int handle, const TioData& key, const TioData& value, const TioData& metadata, const string& eventName )
+	//
+	// everything after "event <handle> ", so it can be shared by all subscribers
+	//
+	string FormatTextEventPayload(const TioData& key, const TioData& value, const TioData& metadata, const string& eventName)
 	{
-		stringstream answer;
-
-		string keyString, valueString, metadataString;
-
-		if(key)
-			keyString = TioDataToString(key);
+		string payload(eventName);
 
-		if(value)
-			valueString = TioDataToString(value);
+		AppendTextFields(&payload, NonEmptyTextField(key), NonEmptyTextField(value), NonEmptyTextField(metadata));
 
-		if(metadata)
-			metadataString = TioDataToString(metadata);
-
-		answer << "event " << handle << " " << eventName;
-
-		if(!keyString.empty())
-			answer << " key " << GetDataTypeAsString(key) << " " << keyString.length();
-
-		if(!valueString.empty())
-			answer << " value " << GetDataTypeAsString(value) << " " << valueString.length();
+		return payload;
+	}
 
-		if(!metadataString.empty())
-			answer << " metadata " << GetDataTypeAsString(metadata) << " " << metadataString.length();
+	static string FormatTextEvent(unsigned int handle, const string& payload)
+	{
+		string event;
 
-		answer << "\r\n";
+		event.reserve(payload.size() + 18);
+		event.append("event ");
+		AppendNumber(&event, handle);
+		event.push_back(' ');
+		event.append(payload);
 
-		if(!keyString.empty())
-			answer << keyString << "\r\n";
+		return event;
+	}
 
-		if(!valueString.empty())
-			answer << valueString << "\r\n";
+	void TioTcpSession::SendTextEvent(unsigned int handle, const TioData& key, const TioData& value, const TioData& metadata, const string& eventName )
+	{
+		SendString(FormatTextEvent(handle, FormatTextEventPayload(key, value, metadata, eventName)));
+	}
 
-		if(!metadataString.empty())
-			answer << metadataString << "\r\n";
+	void TioTcpSession::SendTextEvent(unsigned int handle, const EventQueue::Event& event)
+	{
+		const shared_ptr<const EventQueue::Event::Encoded>& payload = event.GetEncoded(
+			EventQueue::Event::EncodedText,
+			[](const EventQueue::Event& event)
+			{
+				shared_ptr<EventQueue::Event::Encoded> encoded = std::make_shared<EventQueue::Event::Encoded>();
+				encoded->head = FormatTextEventPayload(event.key, event.value, event.metadata, event.name);
+				return encoded;
+			});
 
-		SendString(answer.str());
+		SendString(FormatTextEvent(handle, payload->head));
 	}
 
 	
@@ -695,6 +1043,11 @@ namespace tio
 	}
 
 
+	//
+	// Called by the container, with its lock held, from the thread that changed it.
+	// It can be any session thread, so we only read the subscription info and
+	// queue the data, the Send* functions will take it to our strand
+	//
 	void TioTcpSession::OnEvent(shared_ptr<SUBSCRIPTION_INFO> subscriptionInfo, const string& eventName, 
 		const TioData& key, const TioData& value, const TioData& metadata)
 	{
@@ -809,8 +1162,6 @@ namespace tio
 	void TioTcpSession::SendResultSetItem(unsigned int queryID, 
 		const TioData& key, const TioData& value, const TioData& metadata)
 	{
-		stringstream answer;
-
 		/*
 		if(itemType == "last");
 		{
@@ -820,40 +1171,14 @@ namespace tio
 		}
 		*/
 
-		string keyString, valueString, metadataString;
-
-		if(key)
-			keyString = TioDataToString(key);
-
-		if(value)
-			valueString = TioDataToString(value);
-
-		if(metadata)
-			metadataString = TioDataToString(metadata);
+		string answer("query ");
 
-		answer << "query " << queryID << " item";
+		AppendNumber(&answer, queryID);
+		answer.append(" item");
 
-		if(!keyString.empty())
-			answer << " key " << GetDataTypeAsString(key) << " " << keyString.length();
+		AppendTextFields(&answer, NonEmptyTextField(key), NonEmptyTextField(value), NonEmptyTextField(metadata));
 
-		if(!valueString.empty())
-			answer << " value " << GetDataTypeAsString(value) << " " << valueString.length();
-
-		if(!metadataString.empty())
-			answer << " metadata " << GetDataTypeAsString(metadata) << " " << metadataString.length();
-
-		answer << "\r\n";
-
-		if(!keyString.empty())
-			answer << keyString << "\r\n";
-
-		if(!valueString.empty())
-			answer << valueString << "\r\n";
-
-		if(!metadataString.empty())
-			answer << metadataString << "\r\n";
-
-		SendString(answer.str());
+		SendString(answer);
 	}
 
     void TioTcpSession::SendString(const string& str)
@@ -861,57 +1186,81 @@ namespace tio
 		if(!valid_)
 			return;
 
-        if(pendingSendSize_)
-        {
+		{
+			tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
 			//
 			// If there is too much data pending, the client is not 
 			// receiving it anymore. We're going to disconnect him, otherwise
 			// we will consume too much memory
 			//
-			if(pendingSendSize_ > 100 * 1024 * 1024)
+			if(textSendData_.GetSize() <= 100 * 1024 * 1024)
 			{
-				UnsubscribeAll();
-				server_.OnClientFailed(shared_from_this(), boost::system::error_code());
-				return;
-			}
+				textSendData_.Append(str.data(), str.size());
+				IncreasePendingSendSize(str.size());
 
-            pendingSendData_.push(str);
-            return;
-        }
-        else
-            SendStringNow(str);
+				//
+				// posted, not dispatched, so the answers and events generated 
+				// in this strand run go in the same write
+				//
+				if(!textWriteRunning_)
+				{
+					textWriteRunning_ = true;
 
+					auto shared_this = shared_from_this();
+					strand_.post([shared_this]{ shared_this->SendPendingTextData(); });
+				}
+
+				return;
+			}
+		}
+
+		auto shared_this = shared_from_this();
+
+		Dispatch(
+			[shared_this]()
+			{
+				shared_this->UnsubscribeAll();
+				shared_this->server_.OnClientFailed(shared_this, boost::system::error_code());
+			});
     }
 
-	void TioTcpSession::SendStringNow(const string& str)
+	//
+	// must be called from our strand
+	//
+	void TioTcpSession::SendPendingTextData()
 	{
-		if(!valid_)
-			return;
+		BOOST_ASSERT(strand_.running_in_this_thread());
 
-		size_t answerSize = str.size();
+		tio::recursive_mutex::scoped_lock lock(sendMutex_);
 
-		char* buffer = new char[answerSize];
-		memcpy(buffer, str.c_str(), answerSize);
+		if(!valid_ || textSendData_.IsEmpty())
+		{
+			textWriteRunning_ = false;
+			return;
+		}
 
-		IncreasePendingSendSize(answerSize);
+		//
+		// same limit as the binary protocol (IOV_MAX)
+		//
+		static const size_t MAX_BUFFERS_PER_WRITE = 1024;
+
+		textSendData_.GetBuffers(&textBeingSendData_, MAX_BUFFERS_PER_WRITE);
 
 		auto shared_this = shared_from_this();
 
 		asio::async_write(
 			socket_,
-			asio::buffer(buffer, answerSize), 
-			[shared_this, buffer, answerSize](const error_code& err, size_t sent)
-			{
-				shared_this->OnWrite(buffer, answerSize, err, sent);
-			});
+			textBeingSendData_,
+			strand_.wrap(
+				[shared_this](const error_code& err, size_t sent)
+				{
+					shared_this->OnWrite(err, sent);
+				}));
 	}
 
-	void TioTcpSession::OnWrite(char* buffer, size_t bufferSize, const error_code& err, size_t sent)
+	void TioTcpSession::OnWrite(const error_code& err, size_t sent)
 	{
-		delete[] buffer;
-
-        pendingSendSize_ -= bufferSize;
-
 		sentBytes_ += sent;
 
         if(CheckError(err))
@@ -922,12 +1271,16 @@ namespace tio
             return;
 		}
 
-        if(!pendingSendData_.empty())
-        {
-            SendStringNow(pendingSendData_.front());
-            pendingSendData_.pop();
-			return;
-        }
+		{
+			tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
+			textBeingSendData_.clear();
+			textSendData_.Consume(sent);
+
+			DecreasePendingSendSize(sent);
+		}
+
+		SendPendingTextData();
 
 		SendPendingSnapshots();
 
@@ -979,12 +1332,7 @@ namespace tio
 
 		for(SubscriptionMap::iterator i = subscriptions_.begin() ; i != subscriptions_.end() ; ++i)
 		{
-			unsigned int handle;
-			shared_ptr<SUBSCRIPTION_INFO> info;
-
-			pair_assign(handle, info) = *i;
-
-			GetRegisteredContainer(handle)->Unsubscribe(info->cookie);
+			UnsubscribeContainer(i->second);
 		}
 
 		subscriptions_.clear();
@@ -1123,14 +1471,7 @@ namespace tio
 
 		try
 		{
-			auto shared_this = shared_from_this();
-
-			subscriptionInfo->cookie = container->Subscribe(
-				[shared_this, subscriptionInfo](const string& eventName, const TioData& key, const TioData& value, const TioData& metadata)
-				{
-					shared_this->OnEvent(subscriptionInfo, eventName, key, value, metadata);
-
-				}, start);
+			SubscribeContainer(subscriptionInfo, start);
 			
 			if(sendAnswer)
 				SendString("answer ok\r\n");
@@ -1226,14 +1567,7 @@ namespace tio
 			if(sendAnswer)
 				SendBinaryAnswer();
 
-			auto shared_this = shared_from_this();
-
-			subscriptionInfo->cookie = container->Subscribe(
-				[shared_this, subscriptionInfo](const string& eventName, const TioData& key, const TioData& value, const TioData& metadata)
-				{
-					shared_this->OnEvent(subscriptionInfo, eventName, key, value, metadata);
-				}, 
-				start);
+			SubscribeContainer(subscriptionInfo, start);
 		}
 		catch(std::exception&)
 		{
@@ -1244,6 +1578,166 @@ namespace tio
 		return;
 	}
 
+	//
+	// Subscriptions with an event filter (slices) need the container state
+	// at the moment of the event, so they get the events synchronously from
+	// the container. All the others read the container EventQueue from our strand,
+	// so the thread changing the container doesn't have to format events for us.
+	// The exception are the events raised by our own commands: they're read
+	// right away, so the client gets them before the command answer, like it
+	// did before the queue existed
+	//
+	void TioTcpSession::SubscribeContainer(const shared_ptr<SUBSCRIPTION_INFO>& subscriptionInfo, const string& start)
+	{
+		auto shared_this = shared_from_this();
+
+		EventSink sink = 
+			[shared_this, subscriptionInfo](const string& eventName, const TioData& key, const TioData& value, const TioData& metadata)
+			{
+				shared_this->OnEvent(subscriptionInfo, eventName, key, value, metadata);
+			};
+
+		if(subscriptionInfo->eventFilterStart != 0 || subscriptionInfo->eventFilterEnd != -1)
+		{
+			subscriptionInfo->cookie = subscriptionInfo->container->Subscribe(sink, start);
+			return;
+		}
+
+		//
+		// weak pointers, the reader is owned by the subscription info
+		//
+		weak_ptr<TioTcpSession> weak_this = shared_this;
+		weak_ptr<SUBSCRIPTION_INFO> weakSubscriptionInfo = subscriptionInfo;
+
+		subscriptionInfo->eventReader = subscriptionInfo->container->SubscribeQueued(
+			sink, 
+			start,
+			[weak_this, weakSubscriptionInfo]()
+			{
+				shared_ptr<TioTcpSession> session = weak_this.lock();
+				shared_ptr<SUBSCRIPTION_INFO> subscriptionInfo = weakSubscriptionInfo.lock();
+
+				if(!session || !subscriptionInfo)
+					return;
+
+				if(session->IsRunningCommandInThisThread())
+				{
+					session->ReadQueuedEvents(subscriptionInfo);
+					return;
+				}
+
+				session->strand_.post(
+					[session, subscriptionInfo]()
+					{
+						session->ReadQueuedEvents(subscriptionInfo);
+					});
+			});
+	}
+
+	void TioTcpSession::UnsubscribeContainer(const shared_ptr<SUBSCRIPTION_INFO>& subscriptionInfo)
+	{
+		shared_ptr<EventQueue::Reader> eventReader;
+
+		{
+			boost::mutex::scoped_lock lock(subscriptionInfo->eventReaderMutex);
+			eventReader.swap(subscriptionInfo->eventReader);
+		}
+
+		if(eventReader)
+			subscriptionInfo->container->UnsubscribeQueued(eventReader);
+		else
+			subscriptionInfo->container->Unsubscribe(subscriptionInfo->cookie);
+	}
+
+	void TioTcpSession::ReadQueuedEvents(const shared_ptr<SUBSCRIPTION_INFO>& subscriptionInfo)
+	{
+		static const size_t MAX_EVENTS_PER_READ = 256;
+
+		vector<shared_ptr<const EventQueue::Event>> events;
+
+		events.reserve(MAX_EVENTS_PER_READ);
+
+		for(;;)
+		{
+			if(!valid_)
+				return;
+
+			//
+			// if the client is not reading fast enough, we leave the events
+			// in the queue until the pending data is sent
+			//
+			{
+				tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
+				if(IsPendingSendSizeTooBig())
+				{
+					RegisterLowPendingBytesCallback(
+						[subscriptionInfo](shared_ptr<TioTcpSession> session)
+						{
+							session->ReadQueuedEvents(subscriptionInfo);
+						});
+
+					return;
+				}
+			}
+
+			events.clear();
+
+			{
+				boost::mutex::scoped_lock lock(subscriptionInfo->eventReaderMutex);
+
+				//
+				// unsubscribed while the read was pending
+				//
+				if(!subscriptionInfo->eventReader)
+					return;
+
+				subscriptionInfo->container->ReadEvents(subscriptionInfo->eventReader, &events, MAX_EVENTS_PER_READ);
+
+				//
+				// nothing else to read, the reader is idle and
+				// we'll be woken up by the next event
+				//
+				if(events.empty())
+					return;
+
+				for(const auto& event : events)
+					SendQueuedEvent(subscriptionInfo, *event);
+			}
+
+			//
+			// let other sessions in this thread run
+			//
+			if(events.size() == MAX_EVENTS_PER_READ)
+			{
+				auto shared_this = shared_from_this();
+
+				strand_.post(
+					[shared_this, subscriptionInfo]()
+					{
+						shared_this->ReadQueuedEvents(subscriptionInfo);
+					});
+
+				return;
+			}
+		}
+	}
+
+	//
+	// Queued subscriptions have no event filter (see SubscribeContainer), so
+	// every event is sent as is and we can use the shared encoded event
+	//
+	void TioTcpSession::SendQueuedEvent(const shared_ptr<SUBSCRIPTION_INFO>& subscriptionInfo, const EventQueue::Event& event)
+	{
+		if(!valid_)
+			return;
+
+		if(subscriptionInfo->binaryProtocol)
+			SendBinaryEvent(subscriptionInfo->handle, event);
+		else
+			SendTextEvent(subscriptionInfo->handle, event);
+	}
+
 	void TioTcpSession::SendPendingSnapshots()
 	{
 		if(pendingSnapshots_.empty())
@@ -1350,9 +1844,7 @@ namespace tio
 		if(i == subscriptions_.end())
 			return; //throw std::invalid_argument("not subscribed");
 
-		shared_ptr<ITioContainer> container = GetRegisteredContainer(handle);
-		
-		container->Unsubscribe(i->second->cookie);
+		UnsubscribeContainer(i->second);
 
 		pendingSnapshots_.erase(i->first);
 		subscriptions_.erase(i);
@@ -1428,11 +1920,236 @@ namespace tio
 		SendBinaryMessage(message);
 	}
 
+	static unsigned short Pr1EventPayloadFieldCount(const EventQueue::Event& event)
+	{
+		return 1 + (event.key ? 1 : 0) + (event.value ? 1 : 0) + (event.metadata ? 1 : 0);
+	}
+
+	//
+	// Values this big are written to the socket straight from the event value
+	// instead of being copied into the encoded event. Compressed values are
+	// a new buffer anyway, so they're always copied
+	//
+	static const size_t MIN_GATHERED_VALUE_SIZE = 1024;
+
+	static bool ShouldGatherEventValue(const EventQueue::Event& event, bool compress)
+	{
+		return !compress && 
+			event.value.GetDataType() == TioData::String && 
+			event.value.GetSize() >= MIN_GATHERED_VALUE_SIZE;
+	}
+
+	static string Pr1MessageFields(const shared_ptr<PR1_MESSAGE>& message)
+	{
+		void* buffer;
+		unsigned int bufferSize;
+
+		pr1_message_get_buffer(message.get(), &buffer, &bufferSize);
+
+		const char* fields = static_cast<const char*>(buffer) + sizeof(PR1_MESSAGE_HEADER);
+
+		return string(fields, bufferSize - sizeof(PR1_MESSAGE_HEADER));
+	}
+
+	//
+	// PR1 fields of the event, the event code first. If the value is gathered,
+	// head ends with the value field header and the metadata goes to tail
+	//
+	static shared_ptr<const EventQueue::Event::Encoded> Pr1EncodeEventPayload(const EventQueue::Event& event, bool compress)
+	{
+		bool gatherValue = ShouldGatherEventValue(event, compress);
+		shared_ptr<PR1_MESSAGE> message = Pr1CreateMessage();
+
+		Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_EVENT, EventNameToEventCode(event.name));
+
+		if(event.key) Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_KEY, event.key);
+
+		if(!gatherValue)
+		{
+			if(event.value) Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_VALUE, event.value);
+			if(event.metadata) Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_METADATA, event.metadata);
+		}
+
+		if(compress)
+			Pr1CompressMessage(&message);
+
+		shared_ptr<EventQueue::Event::Encoded> encoded = std::make_shared<EventQueue::Event::Encoded>();
+
+		encoded->head = Pr1MessageFields(message);
+
+		if(!gatherValue)
+			return encoded;
+
+		PR1_MESSAGE_FIELD_HEADER valueFieldHeader;
+		valueFieldHeader.field_id = MESSAGE_FIELD_ID_VALUE;
+		valueFieldHeader.data_type = TIO_DATA_TYPE_STRING;
+		valueFieldHeader.data_size = static_cast<unsigned int>(event.value.GetSize());
+
+		encoded->head.append(reinterpret_cast<const char*>(&valueFieldHeader), sizeof(valueFieldHeader));
+		encoded->value = event.value;
+
+		if(event.metadata)
+		{
+			shared_ptr<PR1_MESSAGE> tail = Pr1CreateMessage();
+			Pr1MessageAddField(tail.get(), MESSAGE_FIELD_ID_METADATA, event.metadata);
+			encoded->tail = Pr1MessageFields(tail);
+		}
+
+		return encoded;
+	}
+
+	static string Pr2EncodeFields(const string& pr1Fields)
+	{
+		string fields(pr1Fields.size(), '\0');
+		
+		fields.resize(pr2_encode_fields(pr1Fields.data(), static_cast<unsigned int>(pr1Fields.size()), &fields[0]));
+
+		return fields;
+	}
+
+	//
+	// event code varint followed by the PR2 key, value and metadata fields
+	//
+	static shared_ptr<const EventQueue::Event::Encoded> Pr2EncodeEventPayload(const EventQueue::Event& event, bool compress)
+	{
+		bool gatherValue = ShouldGatherEventValue(event, compress);
+		shared_ptr<PR1_MESSAGE> message = Pr1CreateMessage();
+
+		if(event.key) Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_KEY, event.key);
+
+		if(!gatherValue)
+		{
+			if(event.value) Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_VALUE, event.value);
+			if(event.metadata) Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_METADATA, event.metadata);
+		}
+
+		if(compress)
+			Pr1CompressMessage(&message);
+
+		shared_ptr<EventQueue::Event::Encoded> encoded = std::make_shared<EventQueue::Event::Encoded>();
+
+		char varint[PR2_MAX_VARINT_SIZE];
+
+		encoded->head.assign(varint, pr2_varint_encode(EventNameToEventCode(event.name), varint));
+		encoded->head.append(Pr2EncodeFields(Pr1MessageFields(message)));
+
+		if(!gatherValue)
+			return encoded;
+
+		//
+		// same tag and size prefix pr2_encode_fields writes for a string
+		//
+		encoded->head.append(varint, pr2_varint_encode(PR2_FIELD_TAG(MESSAGE_FIELD_ID_VALUE, MESSAGE_FIELD_TYPE_STRING), varint));
+		encoded->head.append(varint, pr2_varint_encode(static_cast<unsigned int>(event.value.GetSize()), varint));
+		encoded->value = event.value;
+
+		if(event.metadata)
+		{
+			shared_ptr<PR1_MESSAGE> tail = Pr1CreateMessage();
+			Pr1MessageAddField(tail.get(), MESSAGE_FIELD_ID_METADATA, event.metadata);
+			encoded->tail = Pr2EncodeFields(Pr1MessageFields(tail));
+		}
+
+		return encoded;
+	}
+
+	void TioTcpSession::SendCompactEvent(unsigned int handle, const EventQueue::Event& event)
+	{
+		bool compress = compressionEnabled_;
+
+		const shared_ptr<const EventQueue::Event::Encoded>& payload = event.GetEncoded(
+			compress ? EventQueue::Event::EncodedCompactCompressed : EventQueue::Event::EncodedCompact,
+			[compress](const EventQueue::Event& event){ return Pr2EncodeEventPayload(event, compress); });
+
+		char commandAndHandle[PR2_MAX_VARINT_SIZE * 2];
+		unsigned int commandAndHandleSize = pr2_varint_encode(TIO_COMMAND_EVENT, commandAndHandle);
+		commandAndHandleSize += pr2_varint_encode(handle, commandAndHandle + commandAndHandleSize);
+
+		PR2_EVENT_HEADER header;
+
+		header.size = static_cast<unsigned char>(pr2_varint_encode(
+			static_cast<unsigned int>(commandAndHandleSize + payload->GetSize()), header.buffer));
+
+		memcpy(header.buffer + header.size, commandAndHandle, commandAndHandleSize);
+		header.size += commandAndHandleSize;
+
+		{
+			tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
+			pendingBinarySendData_.push_back(PENDING_BINARY_SEND(header, payload));
+
+			IncreasePendingSendSize(header.size + payload->GetSize());
+		}
+
+		SendPendingBinaryData();
+	}
+
+	void TioTcpSession::SendBinaryEvent(unsigned int handle, const EventQueue::Event& event)
+	{
+		if(!valid_)
+			return;
+
+		if(compactProtocol_)
+		{
+			SendCompactEvent(handle, event);
+			return;
+		}
+
+		bool compress = compressionEnabled_;
+
+		const shared_ptr<const EventQueue::Event::Encoded>& payload = event.GetEncoded(
+			compress ? EventQueue::Event::EncodedBinaryCompressed : EventQueue::Event::EncodedBinary,
+			[compress](const EventQueue::Event& event){ return Pr1EncodeEventPayload(event, compress); });
+
+		PR1_EVENT_HEADER header;
+
+		header.messageHeader.message_size = 
+			sizeof(PR1_EVENT_HEADER) - sizeof(PR1_MESSAGE_HEADER) + payload->GetSize();
+		header.messageHeader.field_count = 2 + Pr1EventPayloadFieldCount(event);
+		header.messageHeader.reserved = 0;
+
+		header.commandFieldHeader.field_id = MESSAGE_FIELD_ID_COMMAND;
+		header.commandFieldHeader.data_type = MESSAGE_FIELD_TYPE_INT;
+		header.commandFieldHeader.data_size = sizeof(int);
+		header.command = TIO_COMMAND_EVENT;
+
+		header.handleFieldHeader.field_id = MESSAGE_FIELD_ID_HANDLE;
+		header.handleFieldHeader.data_type = MESSAGE_FIELD_TYPE_INT;
+		header.handleFieldHeader.data_size = sizeof(int);
+		header.handle = handle;
+
+		{
+			tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
+			pendingBinarySendData_.push_back(PENDING_BINARY_SEND(header, payload));
+
+			IncreasePendingSendSize(sizeof(PR1_EVENT_HEADER) + payload->GetSize());
+		}
+
+		SendPendingBinaryData();
+	}
+
 	void TioTcpSession::SendBinaryErrorAnswer(int errorCode, const string& description)
 	{
-		shared_ptr<PR1_MESSAGE> answer = Pr1CreateMessage();
+		shared_ptr<PR1_MESSAGE> answer;
+
+		//
+		// the client isn't waiting for an answer, so errors go as events
+		//
+		if(Pr1CurrentRequest::IsNoReply())
+		{
+			answer = Pr1CreateMessage();
+
+			pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_EVENT);
+			pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_HANDLE, Pr1CurrentRequest::GetHandle());
+			pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_EVENT, TIO_EVENT_ERROR);
+
+			if(unsigned int requestId = Pr1CurrentRequest::GetId())
+				pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_REQUEST_ID, static_cast<int>(requestId));
+		}
+		else
+			answer = Pr1CreateAnswerMessage();
 
-		pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_ANSWER);
 		pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_ERROR_CODE, errorCode);
 		pr1_message_add_field_string(answer.get(), MESSAGE_FIELD_ID_ERROR_DESC, description.c_str());
 
@@ -1445,48 +2162,87 @@ namespace tio
 
 	void TioTcpSession::SendPendingBinaryData()
 	{
+		if(!strand_.running_in_this_thread())
+		{
+			auto shared_this = shared_from_this();
+			strand_.post([shared_this]{ shared_this->SendPendingBinaryData(); });
+			return;
+		}
+
+		//
+		// ReadBinaryProtocolMessage will flush everything at once
+		//
+		if(executingBinaryBatch_)
+			return;
+
+		tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
+		//
+		// there is a write in progress, OnBinaryMessageSent
+		// will call us again
+		//
 		if(!beingSendData_.empty())
 			return;
 
 		if(pendingBinarySendData_.empty())
 			return;
 
-		static const int SEND_BUFFER_SIZE = 10 * 1024 * 1024;
+		//
+		// Everything goes straight from the messages to the socket (writev).
+		// The limit is the usual IOV_MAX
+		//
+		static const size_t MAX_BUFFERS_PER_WRITE = 1024;
 
-		if(!binarySendBuffer_)
-			binarySendBuffer_.reset(new char[SEND_BUFFER_SIZE]);
+		while(!pendingBinarySendData_.empty() && beingSendData_.size() + 4 <= MAX_BUFFERS_PER_WRITE)
+		{
+			PENDING_BINARY_SEND& item = pendingBinarySendData_.front();
 
-		int bufferSpaceUsed = 0;
-		char* nextBufferSpace = binarySendBuffer_.get();
+			if(item.message)
+			{
+				void* buffer;
+				unsigned int bufferSize;
 
-		while(!pendingBinarySendData_.empty())
-		{
-			const shared_ptr<PR1_MESSAGE>& item = pendingBinarySendData_.front();
+				pr1_message_get_buffer(item.message.get(), &buffer, &bufferSize);
 
-			void* buffer;
-			unsigned int bufferSize;
+				beingSendData_.push_back(asio::buffer(buffer, bufferSize));
+			}
+			else if(item.compactMessage)
+			{
+				beingSendData_.push_back(asio::buffer(*item.compactMessage));
+			}
+			else
+			{
+				if(item.compactEventHeader.size)
+					beingSendData_.push_back(asio::buffer(item.compactEventHeader.buffer, item.compactEventHeader.size));
+				else
+					beingSendData_.push_back(asio::buffer(&item.eventHeader, sizeof(item.eventHeader)));
 
-			pr1_message_get_buffer(item.get(), &buffer, &bufferSize);
+				const EventQueue::Event::Encoded& payload = *item.eventPayload;
 
-			if(bufferSpaceUsed + bufferSize > SEND_BUFFER_SIZE)
-				break;
+				beingSendData_.push_back(asio::buffer(payload.head));
+
+				if(payload.value)
+				{
+					beingSendData_.push_back(asio::buffer(payload.value.AsRaw(), payload.value.GetSize()));
 
-			memcpy(nextBufferSpace, buffer, bufferSize);
-			nextBufferSpace += bufferSize;
-			bufferSpaceUsed += bufferSize;
+					if(!payload.tail.empty())
+						beingSendData_.push_back(asio::buffer(payload.tail));
+				}
+			}
 
-			pendingBinarySendData_.pop_front();
+			beingSendItems_.splice(beingSendItems_.end(), pendingBinarySendData_, pendingBinarySendData_.begin());
 		}
 
 		auto shared_this = shared_from_this();
 
 		asio::async_write(
 			socket_,
-			asio::buffer(binarySendBuffer_.get(), bufferSpaceUsed),
-			[shared_this](const error_code& err, size_t sent)
-		{
-			shared_this->OnBinaryMessageSent(err, sent);
-		});
+			beingSendData_,
+			strand_.wrap(
+				[shared_this](const error_code& err, size_t sent)
+				{
+					shared_this->OnBinaryMessageSent(err, sent);
+				}));
 	}
 
 	void TioTcpSession::OnBinaryMessageSent(const error_code& err, size_t sent)
@@ -1497,8 +2253,15 @@ namespace tio
 			return;
 		}
 
+		{
+			tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
+			beingSendData_.clear();
+			beingSendItems_.clear();
+
+			DecreasePendingSendSize(sent);
+		}
 
-		DecreasePendingSendSize(sent);
 		sentBytes_ += sent;
 
 		BOOST_ASSERT(pendingSendSize_ >= 0);
@@ -1510,6 +2273,8 @@ namespace tio
 
 	void TioTcpSession::RegisterLowPendingBytesCallback(std::function<void(shared_ptr<TioTcpSession>)> lowPendingBytesThresholdCallback)
 	{
+		tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
 		BOOST_ASSERT(IsPendingSendSizeTooBig());
 		lowPendingBytesThresholdCallbacks_.push(lowPendingBytesThresholdCallback);
 		logstream_ << "RegisterLowPendingBytesCallback, " << lowPendingBytesThresholdCallbacks_.size() << " callbacks" << endl;
@@ -1521,28 +2286,64 @@ namespace tio
 
 		BOOST_ASSERT(pendingSendSize_ >= 0);
 
+		//
+		// all the callbacks must run, since the first one might not send
+		// anything and we would not get here again
+		//
 		if(pendingSendSize_ <= PENDING_SEND_SIZE_SMALL_THRESHOLD && !lowPendingBytesThresholdCallbacks_.empty())
 		{
 			logstream_ << "lowPendingBytesThresholdCallbacks_, id= " << id_ << ", "
-				<< lowPendingBytesThresholdCallbacks_.size() << " still pending" << endl;
-
-			// local copy, so callback can register another callback
-			auto callback = lowPendingBytesThresholdCallbacks_.front();
-			lowPendingBytesThresholdCallbacks_.pop();
+				<< lowPendingBytesThresholdCallbacks_.size() << " pending" << endl;
 
 			auto shared_this = shared_from_this();
-			server_.PostCallback([shared_this, callback]{callback(shared_this); });
+
+			while(!lowPendingBytesThresholdCallbacks_.empty())
+			{
+				// local copy, so callback can register another callback
+				auto callback = lowPendingBytesThresholdCallbacks_.front();
+				lowPendingBytesThresholdCallbacks_.pop();
+
+				strand_.post([shared_this, callback]{callback(shared_this); });
+			}
 		}
 	}
 
-	void TioTcpSession::SendBinaryMessage(const shared_ptr<PR1_MESSAGE>& message)
+	void TioTcpSession::SendBinaryMessage(const shared_ptr<PR1_MESSAGE>& originalMessage)
 	{
 		if(!valid_)
 			return;
 
-		pendingBinarySendData_.push_back(message);
+		shared_ptr<PR1_MESSAGE> message = originalMessage;
+
+		if(compressionEnabled_)
+			Pr1CompressMessage(&message);
+
+		if(compactProtocol_)
+		{
+			void* buffer;
+			unsigned int bufferSize;
+
+			pr1_message_get_buffer(message.get(), &buffer, &bufferSize);
+
+			string encoded(bufferSize, '\0');
+			encoded.resize(pr2_encode_message(buffer, &encoded[0]));
 
-		IncreasePendingSendSize(pr1_message_get_data_size(message.get()));
+			int encodedSize = static_cast<int>(encoded.size());
+
+			tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
+			pendingBinarySendData_.push_back(PENDING_BINARY_SEND(std::make_shared<const string>(std::move(encoded))));
+
+			IncreasePendingSendSize(encodedSize);
+		}
+		else
+		{
+			tio::recursive_mutex::scoped_lock lock(sendMutex_);
+
+			pendingBinarySendData_.push_back(PENDING_BINARY_SEND(message));
+
+			IncreasePendingSendSize(pr1_message_get_data_size(message.get()));
+		}
 
 		SendPendingBinaryData();
 	}
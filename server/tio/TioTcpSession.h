@@ -18,6 +18,7 @@ Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
 
 #include "Container.h"
 #include "Command.h"
+#include "OutputBuffer.h"
 #include "../../client/c/tioclient_internals.h"
 //#include "TioTcpServer.h"
 
@@ -84,9 +85,105 @@ namespace tio
 	}
 
 
-inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId, TioData* tiodata)
+	//
+	// Read only view of a received PR1 message. It's parsed in place, so the
+	// buffer must outlive the view, and fields are indexed by id. Field ids
+	// out of the index range are ignored, as is any repeated field
+	//
+	class Pr1MessageView
 	{
-		PR1_MESSAGE_FIELD_HEADER* field = pr1_message_field_find_by_id(message, fieldId);
+	public:
+		static const unsigned int MAX_FIELD_ID = 0x20;
+
+	private:
+		const PR1_MESSAGE_HEADER* header_;
+		const PR1_MESSAGE_FIELD_HEADER* fields_[MAX_FIELD_ID];
+		const char* fieldsEnd_;
+
+	public:
+		Pr1MessageView()
+			: header_(NULL)
+			, fieldsEnd_(NULL)
+		{
+			memset(fields_, 0, sizeof(fields_));
+		}
+
+		//
+		// buffer points to the message header. Returns false if the fields
+		// don't match the header
+		//
+		bool Parse(const void* buffer, size_t bufferSize)
+		{
+			memset(fields_, 0, sizeof(fields_));
+			fieldsEnd_ = NULL;
+
+			header_ = static_cast<const PR1_MESSAGE_HEADER*>(buffer);
+
+			if(bufferSize < sizeof(PR1_MESSAGE_HEADER) || 
+				bufferSize - sizeof(PR1_MESSAGE_HEADER) < header_->message_size)
+			{
+				header_ = NULL;
+				return false;
+			}
+
+			const char* current = reinterpret_cast<const char*>(&header_[1]);
+			const char* end = current + header_->message_size;
+
+			for(unsigned int a = 0 ; a < header_->field_count ; a++)
+			{
+				if(static_cast<size_t>(end - current) < sizeof(PR1_MESSAGE_FIELD_HEADER))
+					return false;
+
+				const PR1_MESSAGE_FIELD_HEADER* field = reinterpret_cast<const PR1_MESSAGE_FIELD_HEADER*>(current);
+
+				current += sizeof(PR1_MESSAGE_FIELD_HEADER);
+
+				if(static_cast<size_t>(end - current) < field->data_size)
+					return false;
+
+				current += field->data_size;
+
+				if(field->field_id < MAX_FIELD_ID && !fields_[field->field_id])
+					fields_[field->field_id] = field;
+			}
+
+			fieldsEnd_ = current;
+
+			return true;
+		}
+
+		//
+		// Walks all fields in message order, including repeated ones. Pass
+		// NULL to get the first field. Returns NULL after the last one
+		//
+		const PR1_MESSAGE_FIELD_HEADER* GetNextField(const PR1_MESSAGE_FIELD_HEADER* field) const
+		{
+			const char* next = field ? 
+				reinterpret_cast<const char*>(&field[1]) + field->data_size :
+				reinterpret_cast<const char*>(&header_[1]);
+
+			return next < fieldsEnd_ ? reinterpret_cast<const PR1_MESSAGE_FIELD_HEADER*>(next) : NULL;
+		}
+
+		const PR1_MESSAGE_FIELD_HEADER* FindField(unsigned int fieldId) const
+		{
+			return fieldId < MAX_FIELD_ID ? fields_[fieldId] : NULL;
+		}
+
+		const void* GetBuffer() const
+		{
+			return header_;
+		}
+
+		size_t GetSize() const
+		{
+			return header_ ? sizeof(PR1_MESSAGE_HEADER) + header_->message_size : 0;
+		}
+	};
+
+	inline bool Pr1MessageGetField(const Pr1MessageView& message, unsigned int fieldId, TioData* tiodata)
+	{
+		const PR1_MESSAGE_FIELD_HEADER* field = message.FindField(fieldId);
 
 		if(!field)
 			return false;
@@ -96,9 +193,9 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 		return true;
 	}
 
-	inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId, string* str)
+	inline bool Pr1MessageGetField(const Pr1MessageView& message, unsigned int fieldId, string* str)
 	{
-		PR1_MESSAGE_FIELD_HEADER* field = pr1_message_field_find_by_id(message, fieldId);
+		const PR1_MESSAGE_FIELD_HEADER* field = message.FindField(fieldId);
 
 		if(!field)
 			return false;
@@ -106,15 +203,15 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 		if(field->data_type != TIO_DATA_TYPE_STRING)
 			return false;
 
-		char* stringBuffer = (char*) (&field[1]);
-		*str = string(stringBuffer, stringBuffer + field->data_size);
+		const char* stringBuffer = (const char*) (&field[1]);
+		str->assign(stringBuffer, stringBuffer + field->data_size);
 
 		return true;
 	}
 
-	inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId, int* value)
+	inline bool Pr1MessageGetField(const Pr1MessageView& message, unsigned int fieldId, int* value)
 	{
-		PR1_MESSAGE_FIELD_HEADER* field = pr1_message_field_find_by_id(message, fieldId);
+		const PR1_MESSAGE_FIELD_HEADER* field = message.FindField(fieldId);
 
 		if(!field)
 			return false;
@@ -127,7 +224,7 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 		return true;
 	}
 	
-	inline void Pr1MessageGetHandleKeyValueAndMetadata(const PR1_MESSAGE* message, int* handle, TioData* key, TioData* value, TioData* metadata)
+	inline void Pr1MessageGetHandleKeyValueAndMetadata(const Pr1MessageView& message, int* handle, TioData* key, TioData* value, TioData* metadata)
 	{
 		if(handle)
 		{
@@ -145,20 +242,251 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 			Pr1MessageGetField(message, MESSAGE_FIELD_ID_METADATA, metadata);
 	}
 
+	//
+	// Batch commands send the key, value and metadata fields repeated, once per
+	// record, always in that order and all of them optional. A record ends when
+	// a field that's not after the last one shows up
+	//
+	inline void Pr1MessageGetRecords(const Pr1MessageView& message, vector<TIO_RECORD>* records)
+	{
+		unsigned int lastFieldId = 0;
+
+		records->clear();
+
+		for(const PR1_MESSAGE_FIELD_HEADER* field = message.GetNextField(NULL) ; field ; field = message.GetNextField(field))
+		{
+			TioData TIO_RECORD::* member;
+
+			switch(field->field_id)
+			{
+			case MESSAGE_FIELD_ID_KEY:
+				member = &TIO_RECORD::key;
+				break;
+			case MESSAGE_FIELD_ID_VALUE:
+				member = &TIO_RECORD::value;
+				break;
+			case MESSAGE_FIELD_ID_METADATA:
+				member = &TIO_RECORD::metadata;
+				break;
+			default:
+				continue;
+			}
+
+			if(records->empty() || field->field_id <= lastFieldId)
+				records->push_back(TIO_RECORD());
+
+			records->back().*member = Pr1MessageToCppTioData(field);
+			lastFieldId = field->field_id;
+		}
+	}
+
+	//
+	// Binary events are the command and handle fields followed by the event,
+	// key, value and metadata fields. Everything but the first two is the same for
+	// all subscribers, so it's encoded only once per event
+	//
+	struct PR1_EVENT_HEADER
+	{
+		PR1_MESSAGE_HEADER messageHeader;
+		PR1_MESSAGE_FIELD_HEADER commandFieldHeader;
+		int command;
+		PR1_MESSAGE_FIELD_HEADER handleFieldHeader;
+		int handle;
+	};
+
+	//
+	// On the compact protocol, the event header is the size prefix followed by
+	// the command and handle varints. The event code goes in the shared payload
+	//
+	struct PR2_EVENT_HEADER
+	{
+		char buffer[PR2_MAX_VARINT_SIZE * 3];
+		unsigned char size;
+	};
+
+	//
+	// Answers and result set items are created and sent all the time, so the
+	// messages (and their stream buffers) are recycled instead of freed. Messages
+	// that grew bigger than MAX_POOLED_BUFFER_SIZE are freed, so a big value
+	// won't keep memory allocated forever
+	//
+	class Pr1MessagePool : boost::noncopyable
+	{
+		static const size_t MAX_FREE_MESSAGES = 4096;
+		static const unsigned int MAX_POOLED_BUFFER_SIZE = 64 * 1024;
+
+		boost::lockfree::stack<PR1_MESSAGE*> freeMessages_;
+
+		Pr1MessagePool()
+			: freeMessages_(MAX_FREE_MESSAGES)
+		{
+		}
+
+	public:
+		~Pr1MessagePool()
+		{
+			PR1_MESSAGE* message;
+
+			while(freeMessages_.pop(message))
+				pr1_message_delete(message);
+		}
+
+		static Pr1MessagePool& Instance()
+		{
+			static Pr1MessagePool pool;
+			return pool;
+		}
+
+		PR1_MESSAGE* Alloc()
+		{
+			PR1_MESSAGE* message;
+
+			if(!freeMessages_.pop(message))
+				return pr1_message_new();
+
+			pr1_message_reset(message);
+
+			return message;
+		}
+
+		void Free(PR1_MESSAGE* message)
+		{
+			if(message->stream_buffer->buffer_size > MAX_POOLED_BUFFER_SIZE || 
+				!freeMessages_.bounded_push(message))
+			{
+				pr1_message_delete(message);
+			}
+		}
+	};
+
 	inline shared_ptr<PR1_MESSAGE> Pr1CreateMessage()
 	{
-		return shared_ptr<PR1_MESSAGE>(pr1_message_new(), &pr1_message_delete);
+		return shared_ptr<PR1_MESSAGE>(
+			Pr1MessagePool::Instance().Alloc(), 
+			[](PR1_MESSAGE* message){ Pr1MessagePool::Instance().Free(message); });
 	}
 	
+	//
+	// Writes that answer with no data. If the client sends MESSAGE_FIELD_ID_NO_REPLY
+	// with them, they aren't answered on success and errors become TIO_EVENT_ERROR
+	//
+	inline bool Pr1IsNoReplyCommand(int command)
+	{
+		switch(command)
+		{
+		case TIO_COMMAND_PUSH_BACK:
+		case TIO_COMMAND_PUSH_FRONT:
+		case TIO_COMMAND_SET:
+		case TIO_COMMAND_INSERT:
+		case TIO_COMMAND_DELETE:
+		case TIO_COMMAND_CLEAR:
+		case TIO_COMMAND_PROPSET:
+		case TIO_COMMAND_PUSH_BACK_MANY:
+		case TIO_COMMAND_SET_MANY:
+			return true;
+		}
+
+		return false;
+	}
+
+	//
+	// Information about the binary message this thread is executing. Request id
+	// is zero if the client didn't send one. Commands running on the container 
+	// owner shard are executed by another thread, so it can't be a session member
+	//
+	class Pr1CurrentRequest : boost::noncopyable
+	{
+		struct RequestInfo
+		{
+			unsigned int requestId;
+			int handle;
+			bool noReply;
+		};
+
+		RequestInfo previous_;
+
+		static RequestInfo& Current()
+		{
+			static thread_local RequestInfo info = {0, 0, false};
+			return info;
+		}
+
+	public:
+		explicit Pr1CurrentRequest(const Pr1MessageView& message)
+			: previous_(Current())
+		{
+			int requestId = 0, handle = 0, command = 0, noReply = 0;
+
+			Pr1MessageGetField(message, MESSAGE_FIELD_ID_REQUEST_ID, &requestId);
+			Pr1MessageGetField(message, MESSAGE_FIELD_ID_HANDLE, &handle);
+			Pr1MessageGetField(message, MESSAGE_FIELD_ID_COMMAND, &command);
+			Pr1MessageGetField(message, MESSAGE_FIELD_ID_NO_REPLY, &noReply);
+
+			Current().requestId = static_cast<unsigned int>(requestId);
+			Current().handle = handle;
+			Current().noReply = noReply != 0 && Pr1IsNoReplyCommand(command);
+		}
+
+		~Pr1CurrentRequest()
+		{
+			Current() = previous_;
+		}
+
+		static unsigned int GetId()
+		{
+			return Current().requestId;
+		}
+
+		static int GetHandle()
+		{
+			return Current().handle;
+		}
+
+		static bool IsNoReply()
+		{
+			return Current().noReply;
+		}
+	};
+
 	inline shared_ptr<PR1_MESSAGE> Pr1CreateAnswerMessage()
 	{
 		shared_ptr<PR1_MESSAGE> answer = Pr1CreateMessage();
 
 		pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_ANSWER);
 
+		if(unsigned int requestId = Pr1CurrentRequest::GetId())
+			pr1_message_add_field_int(answer.get(), MESSAGE_FIELD_ID_REQUEST_ID, static_cast<int>(requestId));
+
 		return answer;
 	}
 
+	//
+	// Field compression, for sessions that asked for it with "protocol binary compressed"
+	// (or compact). String fields bigger than the threshold go as MESSAGE_FIELD_TYPE_COMPRESSED.
+	// Counters are global, the compression_stats command shows them
+	//
+	class Pr1Compression
+	{
+	public:
+		static unsigned int threshold;
+
+		static std::atomic<uint64_t> compressedMessages;
+		static std::atomic<uint64_t> originalBytes;
+		static std::atomic<uint64_t> compressedBytes;
+		static std::atomic<uint64_t> compressMicroseconds;
+		static std::atomic<uint64_t> decompressedMessages;
+		static std::atomic<uint64_t> decompressMicroseconds;
+
+		//
+		// Both return an empty pointer if there's nothing to do, so the
+		// original message must be used. Decompress throws on invalid data
+		//
+		static shared_ptr<PR1_MESSAGE> Compress(const void* pr1Buffer, unsigned int bufferSize);
+		static shared_ptr<PR1_MESSAGE> Decompress(const void* pr1Buffer);
+
+		static string GetStats();
+	};
+
 	inline void Pr1MessageAddFields(shared_ptr<PR1_MESSAGE> message, const TioData* key, const TioData* value, const TioData* metadata)
 	{
 		if(key && key->GetDataType() != TioData::None)
@@ -190,6 +518,7 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 	using namespace boost::asio::ip;
 
 	class TioTcpServer;
+	class ServerShard;
 
 #if 0
 	class BinaryProtocolCommand
@@ -345,6 +674,20 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 
 		asio::io_service& io_service_;
 		tcp::socket socket_;
+
+		//
+		// All socket operations and session state changes run on this strand.
+		// Other threads (events, poppers, groups) must go through Dispatch or
+		// the Send* functions, that are safe to call from any thread
+		//
+		asio::io_service::strand strand_;
+
+		//
+		// protects the pending send queues and sizes, since events can be
+		// queued from any thread holding a container lock. Never call a
+		// container while holding it
+		//
+		tio::recursive_mutex sendMutex_;
 		TioTcpServer& server_;
 
 		Command currentCommand_;
@@ -367,15 +710,91 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 
 		bool binaryProtocol_;
 
+		//
+		// binary protocol with PR2 encoding ("protocol compact"). Requests are
+		// decoded to pr2Request_ and everything we send is encoded back
+		//
+		bool compactProtocol_;
+		shared_ptr<PR1_MESSAGE> pr2Request_;
+
+		//
+		// "protocol binary compressed". Big string fields are compressed both ways,
+		// decompressed requests go to decompressedRequest_
+		//
+		bool compressionEnabled_;
+		shared_ptr<PR1_MESSAGE> decompressedRequest_;
+
 		static std::ostream& logstream_;
 
 		std::queue<std::function<void (shared_ptr<TioTcpSession>)>> lowPendingBytesThresholdCallbacks_;
 
-        std::queue<std::string> pendingSendData_;
+		//
+		// Text answers and events are appended here and sent with a single
+		// write, with everything that was queued while the last one was running
+		//
+		ChainedOutputBuffer textSendData_;
+		std::vector< asio::const_buffer > textBeingSendData_;
+		bool textWriteRunning_;
 		
-		std::list< shared_ptr<PR1_MESSAGE> > pendingBinarySendData_;
+		//
+		// A binary message waiting to be sent. Queued events don't have a message,
+		// they share the encoded payload with the other subscribers and we only
+		// have the header with our handle (see SendBinaryEvent)
+		//
+		struct PENDING_BINARY_SEND
+		{
+			PENDING_BINARY_SEND(const shared_ptr<PR1_MESSAGE>& message)
+				: message(message)
+			{
+				compactEventHeader.size = 0;
+			}
+
+			PENDING_BINARY_SEND(const PR1_EVENT_HEADER& eventHeader, const shared_ptr<const EventQueue::Event::Encoded>& eventPayload)
+				: eventHeader(eventHeader), eventPayload(eventPayload)
+			{
+				compactEventHeader.size = 0;
+			}
+
+			PENDING_BINARY_SEND(const PR2_EVENT_HEADER& compactEventHeader, const shared_ptr<const EventQueue::Event::Encoded>& eventPayload)
+				: compactEventHeader(compactEventHeader), eventPayload(eventPayload)
+			{}
+
+			PENDING_BINARY_SEND(const shared_ptr<const string>& compactMessage)
+				: compactMessage(compactMessage)
+			{
+				compactEventHeader.size = 0;
+			}
+
+			shared_ptr<PR1_MESSAGE> message;
+
+			// message already encoded as PR2
+			shared_ptr<const string> compactMessage;
+
+			PR1_EVENT_HEADER eventHeader;
+			PR2_EVENT_HEADER compactEventHeader;
+			shared_ptr<const EventQueue::Event::Encoded> eventPayload;
+		};
+
+		// answers are deferred until the buffered batch of binary requests finishes
+		bool executingBinaryBatch_;
+
+		//
+		// Commands of this session still running on a container owner shard.
+		// They're all on the same owner, that runs them in order. Any other
+		// command waits until they're done, so it can't overtake them
+		// (see TioTcpServer::DispatchBinaryCommandToOwner)
+		//
+		unsigned int ownerCommands_;
+		const ServerShard* ownerCommandsShard_;
+		bool waitingOwnerCommands_;
+
+		//
+		// The buffers point straight to the items, so the items being sent
+		// stay in beingSendItems_ until the write is done
+		//
+		std::list<PENDING_BINARY_SEND> pendingBinarySendData_;
+		std::list<PENDING_BINARY_SEND> beingSendItems_;
 		std::vector< asio::const_buffer > beingSendData_;
-		shared_ptr<char> binarySendBuffer_;
 
 		struct SUBSCRIPTION_INFO
 		{
@@ -399,6 +818,14 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 			string event_name;
 			shared_ptr<ITioContainer> container;
 			shared_ptr<ITioResultSet> resultSet;
+
+			//
+			// set when the live events come from the container EventQueue
+			// (see SubscribeContainer). The mutex keeps the events in order
+			// when they're read by the strand and by a thread running our command
+			//
+			shared_ptr<EventQueue::Reader> eventReader;
+			boost::mutex eventReaderMutex;
 		};
 
 		//               handle
@@ -411,24 +838,30 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 
 		vector<string> tokens_;
 
-		bool valid_;
+		std::atomic<bool> valid_;
 
 		static int PENDING_SEND_SIZE_BIG_THRESHOLD;
 		static int PENDING_SEND_SIZE_SMALL_THRESHOLD;
 
 		void SendString(const string& str);
-		void SendStringNow(const string& str);
+		void SendPendingTextData();
 		
         void UnsubscribeAll();
 
 		void SendPendingSnapshots();
 
+		void SubscribeContainer(const shared_ptr<SUBSCRIPTION_INFO>& subscriptionInfo, const string& start);
+		void UnsubscribeContainer(const shared_ptr<SUBSCRIPTION_INFO>& subscriptionInfo);
+		void ReadQueuedEvents(const shared_ptr<SUBSCRIPTION_INFO>& subscriptionInfo);
+		void SendQueuedEvent(const shared_ptr<SUBSCRIPTION_INFO>& subscriptionInfo, const EventQueue::Event& event);
+
 		
 				
 
-		void OnBinaryProtocolMessage(PR1_MESSAGE* message, const error_code& err);
-		void OnBinaryProtocolMessageHeader(shared_ptr<PR1_MESSAGE_HEADER> header, const error_code& err);
-		void ReadBinaryProtocolMessage();
+		void OnBinaryProtocolData(const error_code& err, size_t read);
+		bool ParseBufferedBinaryMessage(Pr1MessageView* message, size_t* messageSize, bool* parsed, size_t* missingBytes);
+		bool DecompressBinaryMessage(Pr1MessageView* message);
+		bool ExecuteBufferedBinaryMessages(size_t* missingBytes);
 
 
 	public:
@@ -509,10 +942,32 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 		tcp::socket& GetSocket();
 		void OnAccept();
 		void ReadCommand();
+		void ReadBinaryProtocolMessage();
 
 		unsigned int id();
 		bool UsesBinaryProtocol() const;
 
+		void Dispatch(function<void()> callback);
+
+		//
+		// Marks the thread as executing a command from this session, so events
+		// raised by the command are sent to our own subscriptions right away,
+		// before the command answer (see SubscribeContainer)
+		//
+		class RunningCommand : boost::noncopyable
+		{
+			TioTcpSession* previous_;
+		public:
+			explicit RunningCommand(TioTcpSession* session);
+			~RunningCommand();
+		};
+
+		bool IsRunningCommandInThisThread() const;
+
+		bool CanRunAfterOwnerCommands(const ServerShard* owner) const;
+		void OnOwnerCommandStarted(const ServerShard* owner);
+		void OnOwnerCommandDone();
+
 		void SendResultSet(shared_ptr<ITioResultSet> resultSet, unsigned int queryID);
 
 		void SendResultSetStart(unsigned int queryID);
@@ -521,7 +976,7 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 		bool IsValid();
 
 		void OnReadCommand(const error_code& err, size_t read);
-		void OnWrite(char* buffer, size_t bufferSize, const error_code& err, size_t read);
+		void OnWrite(const error_code& err, size_t sent);
 		void OnReadMessage(const error_code& err);
 		bool CheckError(const error_code& err);
 		void OnCommandData(size_t dataSize, const error_code& err, size_t read);
@@ -536,6 +991,7 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 		void OnPopEvent(unsigned int handle, const string& eventName, const TioData& key, const TioData& value, const TioData& metadata);
 
 		void SendTextEvent(unsigned int handle, const TioData& key, const TioData& value, const TioData& metadata, const string& eventName);
+		void SendTextEvent(unsigned int handle, const EventQueue::Event& event);
 		void SendEvent(shared_ptr<SUBSCRIPTION_INFO> subscriptionInfo, const string& eventName, const TioData& key, const TioData& value, const TioData& metadata);
 
 		void Subscribe(unsigned int handle, const string& start, int filterEnd, bool sendAnswer=true);
@@ -559,6 +1015,8 @@ inline bool Pr1MessageGetField(const PR1_MESSAGE* message, unsigned int fieldId,
 			commandRunning_ = false;
 		}
 		void SendBinaryEvent( int handle, const TioData& key, const TioData& value, const TioData& metadata, const string& eventName );
+		void SendBinaryEvent(unsigned int handle, const EventQueue::Event& event);
+		void SendCompactEvent(unsigned int handle, const EventQueue::Event& event);
 		void SendBinaryResultSet(shared_ptr<ITioResultSet> resultSet, unsigned int queryID, function<bool(const TioData& key)> filterFunction, unsigned maxRecords);
 		void BinaryWaitAndPopNext(unsigned int handle);
 		bool ShouldSendEvent(const shared_ptr<SUBSCRIPTION_INFO>& subscriptionInfo, string eventName, const TioData& key, const TioData& value, const TioData& metadata, std::vector<EXTRA_EVENT>* extraEvents);
@@ -22,7 +22,13 @@ namespace tio {
 {
 
 	using std::make_tuple;
+	using std::deque;
 
+	//
+	// A deque, so it has O(1) access by index and O(1) push and pop in both
+	// ends. Queues (push_back + pop_front, wait and pop) don't move the
+	// other records around
+	//
 	class VectorStorage : 
 		boost::noncopyable,
 		public std::enable_shared_from_this<VectorStorage>,
@@ -30,14 +36,14 @@ namespace tio {
 	{
 	private:
 
-		typedef vector<ValueAndMetadata> DataContainerT;
+		typedef deque<ValueAndMetadata> DataContainerT;
 		DataContainerT data_;
 		string name_, type_;
 		EventDispatcher dispatcher_;
 
 		inline ValueAndMetadata& GetInternalRecord(const TioData& key)
 		{
-			return data_.at(GetRecordNumber(key));
+			return data_[GetValidRecordNumber(key)];
 		}
 
 		inline ValueAndMetadata& GetInternalRecord(const TioData* key)
@@ -53,7 +59,7 @@ namespace tio {
 			if(index < 0)
 			{
 				if(-index > (int)data_.size())
-					throw std::invalid_argument("invalid subscript");
+					throw std::invalid_argument("out of bounds");
 				index = data_.size() + index;
 			}
 
@@ -70,6 +76,20 @@ namespace tio {
 			return GetRecordNumber(*td);
 		}
 
+		//
+		// Same bounds as the list storage: the index must be a record, or the end
+		// of the vector when canBeTheEnd (insert on the end is a push_back)
+		//
+		inline size_t GetValidRecordNumber(const TioData& key, bool canBeTheEnd = false)
+		{
+			size_t recordNumber = GetRecordNumber(key);
+
+			if(recordNumber < data_.size() || (canBeTheEnd && recordNumber == data_.size()))
+				return recordNumber;
+
+			throw std::invalid_argument("out of bounds");
+		}
+
 
 	public:
 
@@ -104,34 +124,47 @@ namespace tio {
 		  }
 
 		  virtual void PushBack(const TioData& key, const TioData& value, const TioData& metadata)
+		  {
+			  PushBack(key, TioData(value), TioData(metadata));
+		  }
+
+		  virtual void PushBack(const TioData& key, TioData&& value, TioData&& metadata)
 		  {
 			  CheckValue(value);
 
-			  data_.push_back(ValueAndMetadata(value, metadata));
+			  data_.emplace_back(std::move(value), std::move(metadata));
 
-			  dispatcher_.RaiseEvent("push_back", static_cast<int>(data_.size() - 1), value, metadata);
+			  const ValueAndMetadata& data = data_.back();
+
+			  dispatcher_.RaiseEvent("push_back", static_cast<int>(data_.size() - 1), data.value, data.metadata);
 		  }
 
 		  virtual void PushFront(const TioData& key, const TioData& value, const TioData& metadata)
+		  {
+			  PushFront(key, TioData(value), TioData(metadata));
+		  }
+
+		  virtual void PushFront(const TioData& key, TioData&& value, TioData&& metadata)
 		  {
 			  CheckValue(value);
-			  data_.insert(data_.begin(), ValueAndMetadata(value, metadata));
+			  data_.emplace_front(std::move(value), std::move(metadata));
+
+			  const ValueAndMetadata& data = data_.front();
 
-			  dispatcher_.RaiseEvent("push_front", key, value, metadata);
+			  dispatcher_.RaiseEvent("push_front", 0, data.value, data.metadata);
 		  }
 
 	private:
-		void _Pop(vector<ValueAndMetadata>::iterator i, TioData* value, TioData* metadata)
+		//
+		// the record is going away, so the data is moved to the caller
+		//
+		static void _Pop(ValueAndMetadata& data, TioData* value, TioData* metadata)
 		{
-			ValueAndMetadata& data = *i;
-
 			if(value)
-				*value = data.value;
+				*value = std::move(data.value);
 
 			if(metadata)
-				*metadata = data.metadata;
-
-			data_.erase(i);
+				*metadata = std::move(data.metadata);
 		}
 	public:
 
@@ -140,13 +173,16 @@ namespace tio {
 			if(data_.empty())
 				throw std::invalid_argument("empty");
 
+			int index = static_cast<int>(data_.size() - 1);
+
 			if(key)
-				*key = static_cast<int>(data_.size() - 1);
+				*key = index;
 
-			_Pop(data_.end() - 1, value, metadata);
+			_Pop(data_.back(), value, metadata);
+			data_.pop_back();
 
 			dispatcher_.RaiseEvent("pop_back", 
-				key ? *key : TIONULL, 
+				index, 
 				value ? *value : TIONULL,
 				metadata ? *metadata : TIONULL);
 		}
@@ -156,10 +192,14 @@ namespace tio {
 			if(data_.empty())
 				throw std::invalid_argument("empty");
 
-			_Pop(data_.begin(), value, metadata);
+			if(key)
+				*key = 0;
+
+			_Pop(data_.front(), value, metadata);
+			data_.pop_front();
 
 			dispatcher_.RaiseEvent("pop_front", 
-				key ? *key : TIONULL, 
+				0, 
 				value ? *value : TIONULL,
 				metadata ? *metadata : TIONULL);
 		}
@@ -172,36 +212,41 @@ namespace tio {
 
 
 		virtual void Set(const TioData& key, const TioData& value, const TioData& metadata)
+		{
+			Set(key, TioData(value), TioData(metadata));
+		}
+
+		virtual void Set(const TioData& key, TioData&& value, TioData&& metadata)
 		{
 			CheckValue(value);
 
 			ValueAndMetadata& data = GetInternalRecord(key);
 
-			data = ValueAndMetadata(value, metadata);
+			data = ValueAndMetadata(std::move(value), std::move(metadata));
 
-			dispatcher_.RaiseEvent("set", key, value, metadata);
+			dispatcher_.RaiseEvent("set", key, data.value, data.metadata);
 		}
 
 		virtual void Insert(const TioData& key, const TioData& value, const TioData& metadata)
 		{
-			CheckValue(value);
+			Insert(key, TioData(value), TioData(metadata));
+		}
 
-			size_t recordNumber = GetRecordNumber(key);
+		virtual void Insert(const TioData& key, TioData&& value, TioData&& metadata)
+		{
+			CheckValue(value);
 
-			// check out of bounds
-			GetRecord(key, NULL, NULL, NULL);
+			size_t recordNumber = GetValidRecordNumber(key, true);
 
-			data_.insert(data_.begin() + recordNumber, ValueAndMetadata(value, metadata));
+			DataContainerT::iterator i = 
+				data_.emplace(data_.begin() + recordNumber, std::move(value), std::move(metadata));
 
-			dispatcher_.RaiseEvent("insert", key, value, metadata);
+			dispatcher_.RaiseEvent("insert", key, i->value, i->metadata);
 		}
 
 		virtual void Delete(const TioData& key, const TioData& value, const TioData& metadata)
 		{
-			size_t recordNumber = GetRecordNumber(key);
-
-			// check out of bounds
-			GetRecord(key, NULL, NULL, NULL);
+			size_t recordNumber = GetValidRecordNumber(key);
 
 			data_.erase(data_.begin() + recordNumber);
 
@@ -252,10 +297,11 @@ namespace tio {
 
 		virtual void GetRecord(const TioData& searchKey, TioData* key, TioData* value, TioData* metadata)
 		{
-			const ValueAndMetadata& data = GetInternalRecord(searchKey);
+			size_t recordNumber = GetValidRecordNumber(searchKey);
+			const ValueAndMetadata& data = data_[recordNumber];
 
 			if(key)
-				*key = searchKey;
+				*key = static_cast<int>(recordNumber);
 
 			if(value)
 				*value = data.value;
@@ -289,10 +335,13 @@ namespace tio {
 				}
 			}
 
-			cookie = dispatcher_.Subscribe(sink);
-
 			if(start.empty())
-				return cookie;
+			{
+				sink("snapshot_end", TIONULL, TIONULL, TIONULL);
+				return dispatcher_.Subscribe(sink);
+			}
+
+			cookie = dispatcher_.Subscribe(sink);
 			
 			//
 			// key is the start index to send
@@ -303,11 +352,18 @@ namespace tio {
 				sink("push_back", (int)x, data.value, data.metadata);
 			}
 
+			sink("snapshot_end", TIONULL, TIONULL, TIONULL);
+
 			return cookie;
 		}
 		virtual void Unsubscribe(unsigned int cookie)
 		{
 			dispatcher_.Unsubscribe(cookie);
 		}
+
+		virtual bool SupportsConcurrentReads()
+		{
+			return true;
+		}
 	};
 }}
@@ -61,12 +61,20 @@ private:
 	typedef map<string, OBJECT> ObjectRules;
 	
 	ObjectRules objectRules_;
-	RuleResult objectDefaultRule_;
+	std::atomic<RuleResult> objectDefaultRule_;
+
+	//
+	// most servers have no object rules, so every data command
+	// can skip the lock and the name lookup
+	//
+	std::atomic<bool> hasObjectRules_;
 
 	typedef map<string, COMMAND> CommandRules;
 	CommandRules commandRules_;
 	RuleResult commandDefaultRule_;
 
+	tio::recursive_mutex mutex_;
+
 	bool FindRuleForTokens(const COMMAND::Tokens& commandTokens, const vector<string>& tokens)
 	{	
 		BOOST_FOREACH(const string& token, tokens)
@@ -94,14 +102,18 @@ public:
 	{
 		objectDefaultRule_ = allow;
 		commandDefaultRule_ = allow;
+		hasObjectRules_ = false;
 	}
 
 	void AddObjectRule(const string& objectType, const string& objectName, 
 		const string& command, const string& token, RuleResult RuleResult)
 	{
+		tio::recursive_mutex::scoped_lock lock(mutex_);
+
 		string fullQualifiedName = objectType + "/" + objectName;
 
 		COMMAND& cmd = objectRules_[fullQualifiedName].commands[command];
+		hasObjectRules_ = true;
 
 		if(RuleResult == allow)
 			cmd.allows.insert(token);
@@ -111,20 +123,27 @@ public:
 
 	void SetObjectDefaultRule(const string& objectType, const string& objectName, RuleResult defaultRule)
 	{
+		tio::recursive_mutex::scoped_lock lock(mutex_);
+
 		string fullQualifiedName = objectType + "/" + objectName;
 
 		OBJECT& obj = objectRules_[fullQualifiedName];
+		hasObjectRules_ = true;
 
 		obj.defaultRule = defaultRule;
 	}
 
 	void SetDefaultRule(RuleResult defaultRule)
 	{
+		tio::recursive_mutex::scoped_lock lock(mutex_);
+
 		objectDefaultRule_ = defaultRule;
 	}
 
 	RuleResult CheckCommandAccess(const string& command, const vector<string>& tokens)
 	{		
+		tio::recursive_mutex::scoped_lock lock(mutex_);
+
 		CommandRules::const_iterator i = commandRules_.find(command);
 
 		if(i == commandRules_.end())
@@ -146,6 +165,11 @@ public:
 	RuleResult CheckObjectAccess(const string& objectType, const string& objectName, 
 		const string& command, const vector<string>& tokens)
 	{
+		if(!hasObjectRules_)
+			return objectDefaultRule_;
+
+		tio::recursive_mutex::scoped_lock lock(mutex_);
+
 		string fullQualifiedName = objectType + "/" + objectName;
 
 		//
@@ -95,7 +95,16 @@ Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
 #include <numeric>
 #include <queue>
 #include <deque>
+#include <unordered_map>
 #include <limits>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <charconv>
+#include <optional>
+#include <cassert>
+#include <string_view>
 
 //
 // macros are evil, you know?
@@ -138,19 +147,101 @@ template<typename T1, typename T2> inline T1 min (T1 l, T2 r) { return l < r ? l
 #endif
 
 //
-// fake mutex, so we can switch mutithread on and off
+// Containers, the container manager and the server shared maps are used
+// by all io_service threads (see --threads), so this must be a real lock
 //
 namespace tio
 {
-	class recursive_mutex
+	typedef boost::recursive_mutex recursive_mutex;
+
+	//
+	// Reader/writer lock where the writer can lock again (and also take a
+	// read lock) from the same thread. Containers need this because event
+	// sinks are called with the container locked and can call the container back.
+	// Readers must not lock again, since a waiting writer would block them.
+	// A thread holding a read lock must never take the write lock: it would
+	// wait for itself to release the read lock, forever. Debug builds assert it
+	//
+	class recursive_shared_mutex : boost::noncopyable
 	{
+		boost::shared_mutex mutex_;
+		std::atomic<std::thread::id> owner_;
+		unsigned recursion_;
+
+#ifndef NDEBUG
+		//
+		// read locks held by the current thread
+		//
+		static std::vector<const recursive_shared_mutex*>& SharedHolds()
+		{
+			static thread_local std::vector<const recursive_shared_mutex*> holds;
+			return holds;
+		}
+#endif
+
 	public:
-		class scoped_lock
+		recursive_shared_mutex()
+			: recursion_(0)
 		{
-		public:
-			scoped_lock(recursive_mutex& m){}
-		};
-	};
-}
+		}
+
+		void lock()
+		{
+			if(owner_ == std::this_thread::get_id())
+			{
+				++recursion_;
+				return;
+			}
+
+			assert(std::find(SharedHolds().begin(), SharedHolds().end(), this) == SharedHolds().end()
+				&& "write lock requested by a thread holding a read lock");
+
+			mutex_.lock();
+			owner_ = std::this_thread::get_id();
+			recursion_ = 1;
+		}
+
+		void unlock()
+		{
+			if(--recursion_ != 0)
+				return;
 
+			owner_ = std::thread::id();
+			mutex_.unlock();
+		}
 
+		void lock_shared()
+		{
+			if(owner_ == std::this_thread::get_id())
+			{
+				++recursion_;
+				return;
+			}
+
+			mutex_.lock_shared();
+
+#ifndef NDEBUG
+			SharedHolds().push_back(this);
+#endif
+		}
+
+		void unlock_shared()
+		{
+			if(owner_ == std::this_thread::get_id())
+			{
+				--recursion_;
+				return;
+			}
+
+#ifndef NDEBUG
+			auto& holds = SharedHolds();
+			holds.erase(std::find(holds.rbegin(), holds.rend(), this).base() - 1);
+#endif
+
+			mutex_.unlock_shared();
+		}
+
+		typedef boost::unique_lock<recursive_shared_mutex> scoped_lock;
+		typedef boost::shared_lock<recursive_shared_mutex> shared_lock;
+	};
+}
@@ -45,6 +45,8 @@ void LoadStorageTypes(ContainerManager* containerManager, const string& dataPath
 
 	containerManager->RegisterFundamentalStorageManagers(mem, mem);
 
+	containerManager->RegisterStorageManager("volatile_vector", mem);
+
 //	containerManager->RegisterStorageManager("bdb_map", bdb);
 //	containerManager->RegisterStorageManager("bdb_vector", bdb);
 
@@ -69,7 +71,10 @@ void SetupContainerManager(
 void RunServer(tio::ContainerManager* manager,
 			   unsigned short port, 
 			   const vector< pair<string, string> >& users,
-			   const string& logFilePath)
+			   const string& logFilePath,
+			   unsigned short threadCount,
+			   unsigned short shardCount,
+			   unsigned short acceptorCount)
 {
 	namespace asio = boost::asio;
 	using namespace boost::asio::ip;
@@ -95,14 +100,46 @@ void RunServer(tio::ContainerManager* manager,
 		}
 	}
 
-	tio::TioTcpServer tioServer(*manager, io_service, e, logFilePath);
+	//
+	// --owner-threads: sessions and containers are spread over one
+	// io_service per shard, each one with its own thread. It only
+	// routes binary data commands, containers still have their locks
+	//
+	std::unique_ptr<tio::ServerShards> shards;
+
+	if(shardCount)
+	{
+		shards.reset(new tio::ServerShards(shardCount));
+		shards->Start();
+	}
+
+	tio::TioTcpServer tioServer(*manager, io_service, e, logFilePath, shards.get(), acceptorCount);
 
 	tioServer.Start();
 
 	cout << "Up and running!" << endl;
 
+	//
+	// in shard mode the acceptors can all be running on the shards, but
+	// the main io_service is still used for server callbacks
+	//
+	asio::io_service::work work(io_service);
+
+	//
+	// the current thread is one of the io_service threads
+	//
+	boost::thread_group threads;
+
+	for(unsigned short a = 1 ; a < threadCount ; a++)
+		threads.create_thread([&io_service](){ io_service.run(); });
+
 	io_service.run();
 
+	threads.join_all();
+
+	if(shards)
+		shards->Stop();
+
 #ifndef _WIN32
 	//ProfilerStop();
 #endif
@@ -449,6 +486,87 @@ protected:
 		return 0;
 	}
 
+	static void c2cpp_records(unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas, vector<TIO_RECORD>* records)
+	{
+		records->resize(count);
+
+		for(unsigned int a = 0 ; a < count ; a++)
+		{
+			TIO_RECORD& record = (*records)[a];
+
+			record.key = c2cpp(keys ? &keys[a] : NULL);
+			record.value = c2cpp(values ? &values[a] : NULL);
+			record.metadata = c2cpp(metadatas ? &metadatas[a] : NULL);
+		}
+	}
+
+	virtual int container_push_back_many(void* handle, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)
+	{
+		ITioContainer* container = ((shared_ptr<ITioContainer>*)handle)->get();
+
+		try
+		{
+			vector<TIO_RECORD> records;
+			c2cpp_records(count, keys, values, metadatas, &records);
+			container->PushBackMany(records);
+		}
+		catch(std::exception&)
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	virtual int container_set_many(void* handle, unsigned int count, const struct TIO_DATA* keys, const struct TIO_DATA* values, const struct TIO_DATA* metadatas)
+	{
+		ITioContainer* container = ((shared_ptr<ITioContainer>*)handle)->get();
+
+		try
+		{
+			vector<TIO_RECORD> records;
+			c2cpp_records(count, keys, values, metadatas, &records);
+			container->SetMany(records);
+		}
+		catch(std::exception&)
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	virtual int container_get_many(void* handle, unsigned int count, const struct TIO_DATA* search_keys, struct TIO_DATA* keys, struct TIO_DATA* values, struct TIO_DATA* metadatas, int* results)
+	{
+		ITioContainer* container = ((shared_ptr<ITioContainer>*)handle)->get();
+
+		try
+		{
+			vector<TioData> searchKeys(count);
+			vector<TIO_RECORD> records;
+			vector<bool> found;
+
+			for(unsigned int a = 0 ; a < count ; a++)
+				searchKeys[a] = c2cpp(&search_keys[a]);
+
+			container->GetMany(searchKeys, &records, &found);
+
+			for(unsigned int a = 0 ; a < count ; a++)
+			{
+				if(keys) *c2cpp(&keys[a]).outptr() = records[a].key;
+				if(values) *c2cpp(&values[a]).outptr() = records[a].value;
+				if(metadatas) *c2cpp(&metadatas[a]).outptr() = records[a].metadata;
+				if(results) results[a] = found[a] ? TIO_SUCCESS : TIO_ERROR_NO_SUCH_OBJECT;
+			}
+		}
+		catch(std::exception&)
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
 	virtual int container_get_count(void* handle, int* count)
 	{
 		ITioContainer* container = ((shared_ptr<ITioContainer>*)handle)->get();
@@ -677,8 +795,11 @@ int main(int argc, char* argv[])
 			("plugin", po::value< vector<string> >(), "load and run a plugin")
 			("plugin-parameter", po::value< vector<string> >(), "parameters to be passed to plugins. name=value")
 			("port", po::value<unsigned short>(), "listening port. If not informed, 2605")
-			("threads", po::value<unsigned short>(), "number of running threads")
+			("threads", po::value<unsigned short>(), "number of io threads. If not informed, 1. Use 0 for one thread per core")
+			("owner-threads", po::value<unsigned short>(), "spread sessions over this many threads, each one owning part of the containers. Binary data commands run on the owner thread, everything else on the session thread, and containers are still locked. Use 0 for one per core")
+			("acceptors", po::value<unsigned short>(), "number of listening sockets, bound with SO_REUSEPORT. If not informed, 1. Use 0 for one per thread (or owner thread)")
 			("log-path", po::value<string>(), "transaction log file path. It must be a full file path, not just the directory. Ex: c:\\data\\tio.log")
+			("compression-threshold", po::value<unsigned int>(), "string fields bigger than this are compressed, for clients that ask for it. If not informed, 4096. Use 0 to disable")
 			("data-path", po::value<string>(), "sets data path");
 
 		po::variables_map vm;
@@ -789,11 +910,57 @@ int main(int argc, char* argv[])
 				cout << "Saving transaction log to " << logFilePath << endl;
 			}
 		
+			unsigned short threadCount = 1;
+
+			if(vm.count("threads"))
+			{
+				threadCount = vm["threads"].as<unsigned short>();
+
+				if(threadCount == 0)
+					threadCount = static_cast<unsigned short>(std::max(1u, boost::thread::hardware_concurrency()));
+			}
+
+			cout << "Running " << threadCount << " thread(s)" << endl;
+
+			unsigned short shardCount = 0;
+
+			if(vm.count("owner-threads"))
+			{
+				shardCount = vm["owner-threads"].as<unsigned short>();
+
+				if(shardCount == 0)
+					shardCount = static_cast<unsigned short>(std::max(1u, boost::thread::hardware_concurrency()));
+
+				cout << "Running " << shardCount << " container owner thread(s)" << endl;
+			}
+
+			if(vm.count("compression-threshold"))
+			{
+				tio::Pr1Compression::threshold = vm["compression-threshold"].as<unsigned int>();
+
+				cout << "Compression threshold is " << tio::Pr1Compression::threshold << " bytes" << endl;
+			}
+
+			unsigned short acceptorCount = 1;
+
+			if(vm.count("acceptors"))
+			{
+				acceptorCount = vm["acceptors"].as<unsigned short>();
+
+				if(acceptorCount == 0)
+					acceptorCount = shardCount ? shardCount : threadCount;
+
+				cout << "Using " << acceptorCount << " acceptor(s)" << endl;
+			}
+		
 			RunServer(
 				&containerManager,
 				port,
 				users,
-				logFilePath);
+				logFilePath,
+				threadCount,
+				shardCount,
+				acceptorCount);
 		}
 	}
 	catch(std::exception& ex)
@@ -449,6 +449,14 @@ namespace tio
 		return answer.parameter;
 	}
 
+	const string& RemoteContainer::GetFullQualifiedName()
+	{
+		if(fullQualifiedName_.empty())
+			fullQualifiedName_ = GetType() + "/" + GetName();
+
+		return fullQualifiedName_;
+	}
+
 	string RemoteContainer::Command(const string& command)
 	{
 		ProtocolAnswer answer;
@@ -491,6 +499,46 @@ namespace tio
 		SendDataCommand("set", key, value, metaData);
 	}
 
+	//
+	// the text protocol has no batch commands
+	//
+	void RemoteContainer::PushBackMany(const vector<TIO_RECORD>& records)
+	{
+		for(const TIO_RECORD& record : records)
+			PushBack(record.key, record.value, record.metadata);
+	}
+
+	void RemoteContainer::SetMany(const vector<TIO_RECORD>& records)
+	{
+		for(const TIO_RECORD& record : records)
+			Set(record.key, record.value, record.metadata);
+	}
+
+	void RemoteContainer::GetMany(const vector<TioData>& searchKeys, vector<TIO_RECORD>* records, vector<bool>* found)
+	{
+		records->clear();
+		records->resize(searchKeys.size());
+
+		found->clear();
+		found->resize(searchKeys.size());
+
+		for(size_t a = 0 ; a < searchKeys.size() ; a++)
+		{
+			TIO_RECORD& record = (*records)[a];
+
+			try
+			{
+				GetRecord(searchKeys[a], &record.key, &record.value, &record.metadata);
+				(*found)[a] = true;
+			}
+			catch(std::exception&)
+			{
+				record = TIO_RECORD();
+				record.key = searchKeys[a];
+			}
+		}
+	}
+
 	void RemoteContainer::Insert(const TioData& key, const TioData& value, const TioData& metaData)
 	{
 		SendDataCommand("insert", key, value, metaData);
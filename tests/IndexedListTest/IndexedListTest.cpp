@@ -0,0 +1,329 @@
+/*
+Tio: The Information Overlord
+Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//
+// Differential test for IndexedList (the volatile_list storage). Every change
+// is done to an IndexedList and to a std::vector, and they must have the same
+// contents, in the same order, when accessed by index or walked with iterators
+//
+
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include <random>
+#include <iostream>
+#include <cstdlib>
+
+#include "IndexedList.h"
+
+using std::vector;
+using std::cout;
+using std::endl;
+
+using tio::IndexedList;
+
+#define CHECK(x) \
+	if(!(x)) \
+	{ \
+		cout << __FILE__ << "(" << __LINE__ << "): check failed: " << #x << endl; \
+		exit(1); \
+	}
+
+class IndexedListChecker
+{
+	IndexedList<int> list_;
+	vector<int> reference_;
+
+public:
+	size_t size() const
+	{
+		return reference_.size();
+	}
+
+	void insert(size_t index, int value)
+	{
+		list_.insert(index, std::move(value));
+		reference_.insert(reference_.begin() + index, value);
+
+		CHECK(list_.size() == reference_.size());
+	}
+
+	void push_back(int value)
+	{
+		list_.push_back(std::move(value));
+		reference_.push_back(value);
+	}
+
+	void push_front(int value)
+	{
+		list_.push_front(std::move(value));
+		reference_.insert(reference_.begin(), value);
+	}
+
+	void erase(size_t index)
+	{
+		list_.erase(index);
+		reference_.erase(reference_.begin() + index);
+
+		CHECK(list_.size() == reference_.size());
+	}
+
+	void pop_back()
+	{
+		list_.pop_back();
+		reference_.pop_back();
+	}
+
+	void pop_front()
+	{
+		list_.pop_front();
+		reference_.erase(reference_.begin());
+	}
+
+	void clear()
+	{
+		list_.clear();
+		reference_.clear();
+	}
+
+	//
+	// walks from index to the end, so it crosses every leaf after that one
+	//
+	void CheckWalkFrom(size_t index) const
+	{
+		size_t position = index;
+
+		for(auto i = list_.iterator_at(index) ; i != list_.end() ; ++i, ++position)
+		{
+			CHECK(position < reference_.size());
+			CHECK(*i == reference_[position]);
+		}
+
+		CHECK(position == reference_.size());
+	}
+
+	void CheckItem(size_t index) const
+	{
+		CHECK(list_[index] == reference_[index]);
+	}
+
+	void CheckAll()
+	{
+		CHECK(list_.size() == reference_.size());
+		CHECK(list_.empty() == reference_.empty());
+
+		size_t position = 0;
+
+		for(auto i = list_.begin() ; i != list_.end() ; ++i, ++position)
+		{
+			CHECK(position < reference_.size());
+			CHECK(*i == reference_[position]);
+		}
+
+		CHECK(position == reference_.size());
+
+		for(size_t a = 0 ; a < reference_.size() ; a++)
+			CheckItem(a);
+
+		if(!reference_.empty())
+		{
+			CHECK(list_.front() == reference_.front());
+			CHECK(list_.back() == reference_.back());
+		}
+
+		CHECK(list_.iterator_at(reference_.size()) == list_.end());
+	}
+};
+
+//
+// enough items for a tree with three levels, 64 per node
+//
+static const int BIG_LIST_SIZE = 20000;
+
+void TestEmpty()
+{
+	IndexedList<int> list;
+
+	CHECK(list.empty());
+	CHECK(list.begin() == list.end());
+	CHECK(list.iterator_at(0) == list.end());
+
+	list.push_back(1);
+	list.pop_back();
+
+	CHECK(list.empty());
+	CHECK(list.begin() == list.end());
+}
+
+void TestGrowAtTheEnds()
+{
+	IndexedListChecker checker;
+
+	for(int a = 0 ; a < BIG_LIST_SIZE ; a++)
+	{
+		if(a % 3 == 0)
+			checker.push_front(a);
+		else
+			checker.push_back(a);
+	}
+
+	checker.CheckAll();
+}
+
+void TestInsertInTheMiddle()
+{
+	IndexedListChecker checker;
+
+	for(int a = 0 ; a < BIG_LIST_SIZE ; a++)
+		checker.insert(checker.size() / 2, a);
+
+	checker.CheckAll();
+
+	//
+	// index == size is an append
+	//
+	checker.insert(checker.size(), -1);
+	checker.CheckAll();
+}
+
+//
+// Erasing from the front merges the first child with the one after it,
+// erasing from the back merges the last child with the one before it
+//
+void TestShrinkFromTheEnds()
+{
+	IndexedListChecker checker;
+
+	for(int a = 0 ; a < BIG_LIST_SIZE ; a++)
+		checker.push_back(a);
+
+	while(checker.size() > BIG_LIST_SIZE / 2)
+	{
+		checker.pop_front();
+
+		if(checker.size() % 500 == 0)
+		{
+			checker.CheckAll();
+			checker.CheckWalkFrom(checker.size() / 3);
+		}
+	}
+
+	while(checker.size())
+	{
+		checker.pop_back();
+
+		if(checker.size() % 500 == 0)
+		{
+			checker.CheckAll();
+			checker.CheckWalkFrom(checker.size() / 3);
+		}
+	}
+
+	checker.CheckAll();
+}
+
+void TestEraseInTheMiddle()
+{
+	IndexedListChecker checker;
+
+	for(int a = 0 ; a < BIG_LIST_SIZE ; a++)
+		checker.push_back(a);
+
+	while(checker.size())
+	{
+		checker.erase(checker.size() / 2);
+
+		if(checker.size() % 500 == 0)
+			checker.CheckAll();
+	}
+
+	checker.CheckAll();
+}
+
+//
+// Random changes at random places. Some rounds push the operations
+// to one of the ends, where the split and merge rules are different
+//
+void TestRandom()
+{
+	std::mt19937 random(2605);
+
+	enum Bias { Bias_None, Bias_Back, Bias_Front, Bias_EraseFront, Bias_Count };
+
+	for(int round = 0 ; round < 100 ; round++)
+	{
+		IndexedListChecker checker;
+		Bias bias = static_cast<Bias>(random() % Bias_Count);
+		int operationCount = random() % BIG_LIST_SIZE;
+
+		for(int a = 0 ; a < operationCount ; a++)
+		{
+			unsigned operation = random() % 10;
+
+			if(operation < 5 || checker.size() == 0)
+			{
+				size_t index =
+					bias == Bias_Back ? checker.size() :
+					bias == Bias_Front ? 0 :
+					random() % (checker.size() + 1);
+
+				checker.insert(index, static_cast<int>(random()));
+			}
+			else if(operation < 8)
+			{
+				size_t index = bias == Bias_EraseFront ? 0 : random() % checker.size();
+
+				checker.erase(index);
+			}
+			else if(operation == 8)
+				checker.CheckItem(random() % checker.size());
+			else
+				checker.CheckWalkFrom(random() % (checker.size() + 1));
+		}
+
+		checker.CheckAll();
+
+		while(checker.size())
+		{
+			if(random() % 2)
+				checker.pop_back();
+			else
+				checker.pop_front();
+
+			if(checker.size() % 256 == 0)
+				checker.CheckAll();
+		}
+
+		checker.CheckAll();
+	}
+}
+
+int main()
+{
+	TestEmpty();
+	TestGrowAtTheEnds();
+	TestInsertInTheMiddle();
+	TestShrinkFromTheEnds();
+	TestEraseInTheMiddle();
+	TestRandom();
+
+	cout << "IndexedList: all tests passed" << endl;
+
+	return 0;
+}
@@ -0,0 +1,599 @@
+/*
+Tio: The Information Overlord
+Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//
+// Tests for the PR2 encoder and decoder and for field compression. Messages
+// are encoded from PR1 and decoded back, and hand made PR2 bodies and
+// compressed fields check what the decoders accept
+//
+
+#include <string>
+#include <vector>
+#include <climits>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+
+#include "tioclient_internals.h"
+
+using std::string;
+using std::vector;
+using std::cout;
+using std::endl;
+
+#define CHECK(x) \
+	if(!(x)) \
+	{ \
+		cout << __FILE__ << "(" << __LINE__ << "): check failed: " << #x << endl; \
+		exit(1); \
+	}
+
+static string GetPr1Buffer(PR1_MESSAGE* message)
+{
+	void* buffer;
+	unsigned int size;
+
+	pr1_message_get_buffer(message, &buffer, &size);
+
+	return string(static_cast<const char*>(buffer), size);
+}
+
+static string Varint(unsigned int value)
+{
+	char buffer[PR2_MAX_VARINT_SIZE];
+
+	return string(buffer, pr2_varint_encode(value, buffer));
+}
+
+//
+// The output buffer has the size of the PR1 message and is followed by a
+// guard, so writing past it or returning a bigger size fails the test
+//
+static string Pr2Encode(PR1_MESSAGE* message)
+{
+	static const char GUARD = '\x5A';
+	static const unsigned int GUARD_SIZE = 64;
+
+	string pr1 = GetPr1Buffer(message);
+	vector<char> output(pr1.size() + GUARD_SIZE, GUARD);
+
+	unsigned int size = pr2_encode_message(pr1.data(), &output[0]);
+
+	CHECK(size <= pr1.size());
+
+	for(size_t a = pr1.size() ; a < output.size() ; a++)
+		CHECK(output[a] == GUARD);
+
+	unsigned int bodySize;
+	int prefixSize = pr2_read_message_size(&output[0], size, &bodySize);
+
+	CHECK(prefixSize > 0);
+	CHECK(prefixSize + bodySize == size);
+
+	//
+	// the body is built after a full size prefix and moved back later
+	//
+	CHECK(PR2_MAX_VARINT_SIZE + bodySize <= pr1.size());
+
+	return string(&output[0], size);
+}
+
+static int Pr2DecodeBody(const string& body, PR1_MESSAGE* message)
+{
+	//
+	// a copy with the exact size, so reading past the body is noticed by memory checkers
+	//
+	vector<char> copy(body.begin(), body.end());
+
+	return pr2_decode_message(copy.empty() ? NULL : &copy[0], static_cast<unsigned int>(copy.size()), message);
+}
+
+static void CheckRoundTrip(PR1_MESSAGE* message, PR1_MESSAGE* expected)
+{
+	string pr2 = Pr2Encode(message);
+	unsigned int bodySize;
+	int prefixSize = pr2_read_message_size(pr2.data(), static_cast<unsigned int>(pr2.size()), &bodySize);
+
+	PR1_MESSAGE* decoded = pr1_message_new();
+
+	CHECK(Pr2DecodeBody(pr2.substr(prefixSize), decoded) == TIO_SUCCESS);
+	CHECK(GetPr1Buffer(decoded) == GetPr1Buffer(expected));
+
+	pr1_message_delete(decoded);
+}
+
+static void AddAllFieldTypes(PR1_MESSAGE* message)
+{
+	pr1_message_add_field_string(message, MESSAGE_FIELD_ID_KEY, "key");
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_VALUE, -1234);
+	pr1_message_add_field_double(message, MESSAGE_FIELD_ID_METADATA, 3.25);
+	pr1_message_add_field(message, MESSAGE_FIELD_ID_KEY, MESSAGE_FIELD_TYPE_NONE, NULL, 0);
+	pr1_message_add_field_string(message, MESSAGE_FIELD_ID_VALUE, "");
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_METADATA, 0);
+	pr1_message_add_field(message, MESSAGE_FIELD_ID_VALUE, MESSAGE_FIELD_TYPE_COMPRESSED, "\0\0\0\0", 4);
+	pr1_message_add_field_string(message, 0xFFFF, string(1000, 'x').c_str());
+}
+
+void TestVarint()
+{
+	struct { unsigned int value; unsigned int size; } values[] =
+	{
+		{ 0, 1 }, { 0x7F, 1 }, { 0x80, 2 }, { 0x3FFF, 2 }, { 0x4000, 3 },
+		{ 0xFFFFFFF, 4 }, { 0x10000000, 5 }, { 0xFFFFFFFF, 5 }
+	};
+
+	for(auto& v : values)
+	{
+		string encoded = Varint(v.value);
+		const char* current = encoded.data();
+		unsigned int decoded;
+
+		CHECK(encoded.size() == v.size);
+		CHECK(pr2_varint_decode(&current, encoded.data() + encoded.size(), &decoded));
+		CHECK(decoded == v.value);
+		CHECK(current == encoded.data() + encoded.size());
+
+		//
+		// every prefix is incomplete
+		//
+		for(size_t a = 0 ; a < encoded.size() ; a++)
+		{
+			current = encoded.data();
+			CHECK(!pr2_varint_decode(&current, encoded.data() + a, &decoded));
+		}
+	}
+
+	const char* current;
+	unsigned int decoded;
+
+	//
+	// longer than needed is fine, as long as it fits in five bytes
+	//
+	string padded("\x81\x80\x80\x80\x00", 5);
+	current = padded.data();
+	CHECK(pr2_varint_decode(&current, padded.data() + padded.size(), &decoded));
+	CHECK(decoded == 1);
+
+	string sixBytes("\x81\x80\x80\x80\x80\x00", 6);
+	current = sixBytes.data();
+	CHECK(!pr2_varint_decode(&current, sixBytes.data() + sixBytes.size(), &decoded));
+
+	//
+	// bits past the 32th
+	//
+	string tooBig("\xFF\xFF\xFF\xFF\x1F", 5);
+	current = tooBig.data();
+	CHECK(!pr2_varint_decode(&current, tooBig.data() + tooBig.size(), &decoded));
+
+	//
+	// size prefix
+	//
+	unsigned int bodySize;
+
+	CHECK(pr2_read_message_size("\x80\x01", 2, &bodySize) == 2);
+	CHECK(bodySize == 0x80);
+	CHECK(pr2_read_message_size("\x80\x80", 2, &bodySize) == 0);
+	CHECK(pr2_read_message_size("\x80\x80\x80\x80\x80", 5, &bodySize) == TIO_ERROR_PROTOCOL);
+}
+
+void TestRoundTrip()
+{
+	PR1_MESSAGE* message = pr1_message_new();
+
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_SET);
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_HANDLE, 42);
+	AddAllFieldTypes(message);
+
+	CheckRoundTrip(message, message);
+
+	pr1_message_delete(message);
+
+	//
+	// events have handle and event code right after the command
+	//
+	message = pr1_message_new();
+
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_EVENT);
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_HANDLE, 7);
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_EVENT, TIO_COMMAND_PUSH_BACK);
+	AddAllFieldTypes(message);
+
+	CheckRoundTrip(message, message);
+
+	pr1_message_delete(message);
+
+	//
+	// fields out of that order come back in it
+	//
+	message = pr1_message_new();
+	PR1_MESSAGE* expected = pr1_message_new();
+
+	pr1_message_add_field_string(message, MESSAGE_FIELD_ID_KEY, "key");
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_EVENT, TIO_COMMAND_SET);
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_HANDLE, 7);
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_EVENT);
+
+	pr1_message_add_field_int(expected, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_EVENT);
+	pr1_message_add_field_int(expected, MESSAGE_FIELD_ID_HANDLE, 7);
+	pr1_message_add_field_int(expected, MESSAGE_FIELD_ID_EVENT, TIO_COMMAND_SET);
+	pr1_message_add_field_string(expected, MESSAGE_FIELD_ID_KEY, "key");
+
+	CheckRoundTrip(message, expected);
+
+	pr1_message_delete(message);
+	pr1_message_delete(expected);
+}
+
+//
+// INT fields are zigzag encoded, these need the five bytes
+//
+void TestFiveByteInt()
+{
+	int values[] = { INT_MIN, INT_MAX, -0x08000001, 0x08000000 };
+
+	for(int value : values)
+	{
+		PR1_MESSAGE* message = pr1_message_new();
+
+		pr1_message_add_field_int(message, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_SET);
+		pr1_message_add_field_int(message, MESSAGE_FIELD_ID_VALUE, value);
+
+		// prefix, command, tag and the value
+		CHECK(Pr2Encode(message).size() == 1 + 1 + 1 + PR2_MAX_VARINT_SIZE);
+
+		CheckRoundTrip(message, message);
+
+		pr1_message_delete(message);
+	}
+}
+
+void TestTags()
+{
+	PR1_MESSAGE* message = pr1_message_new();
+	PR1_MESSAGE* expected = pr1_message_new();
+
+	pr1_message_add_field_int(expected, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_SET);
+	pr1_message_add_field_int(expected, MESSAGE_FIELD_ID_KEY, -1);
+	pr1_message_add_field_int(expected, 0xFFFF, 1);
+
+	//
+	// a tag in five bytes, and the biggest field id
+	//
+	string body =
+		Varint(TIO_COMMAND_SET) +
+		string("\x80\x80\x80\x80\x00", 5) + Varint(1) +
+		Varint(PR2_FIELD_TAG(0xFFFF, MESSAGE_FIELD_TYPE_INT)) + Varint(2);
+
+	body[1] = static_cast<char>(0x80 | PR2_FIELD_TAG(MESSAGE_FIELD_ID_KEY, MESSAGE_FIELD_TYPE_INT));
+
+	CHECK(Pr2DecodeBody(body, message) == TIO_SUCCESS);
+	CHECK(GetPr1Buffer(message) == GetPr1Buffer(expected));
+
+	//
+	// field ids are 16 bits
+	//
+	pr1_message_reset(message);
+	body = Varint(TIO_COMMAND_SET) + Varint(PR2_FIELD_TAG(0x10000, MESSAGE_FIELD_TYPE_NONE));
+	CHECK(Pr2DecodeBody(body, message) == TIO_ERROR_PROTOCOL);
+
+	pr1_message_reset(message);
+	body = Varint(TIO_COMMAND_SET) + Varint(0xFFFFFFF8);
+	CHECK(Pr2DecodeBody(body, message) == TIO_ERROR_PROTOCOL);
+
+	//
+	// types after COMPRESSED
+	//
+	for(unsigned int type = MESSAGE_FIELD_TYPE_COMPRESSED + 1 ; type <= 8 ; type++)
+	{
+		pr1_message_reset(message);
+		body = Varint(TIO_COMMAND_SET) + Varint(PR2_FIELD_TAG(MESSAGE_FIELD_ID_KEY, type)) + Varint(0);
+		CHECK(Pr2DecodeBody(body, message) == TIO_ERROR_PROTOCOL);
+	}
+
+	pr1_message_delete(message);
+	pr1_message_delete(expected);
+}
+
+void TestTruncatedBody()
+{
+	PR1_MESSAGE* message = pr1_message_new();
+
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_EVENT);
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_HANDLE, 1000);
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_EVENT, TIO_COMMAND_SET);
+	AddAllFieldTypes(message);
+
+	string pr2 = Pr2Encode(message);
+	unsigned int bodySize;
+	int prefixSize = pr2_read_message_size(pr2.data(), static_cast<unsigned int>(pr2.size()), &bodySize);
+	string body = pr2.substr(prefixSize);
+
+	PR1_MESSAGE* full = pr1_message_new();
+	CHECK(Pr2DecodeBody(body, full) == TIO_SUCCESS);
+
+	//
+	// a cut between two fields is a valid smaller message, any
+	// other cut is an error
+	//
+	PR1_MESSAGE* decoded = pr1_message_new();
+	int validCuts = 0;
+
+	for(size_t size = 0 ; size < body.size() ; size++)
+	{
+		pr1_message_reset(decoded);
+
+		int result = Pr2DecodeBody(body.substr(0, size), decoded);
+
+		if(result == TIO_SUCCESS)
+		{
+			CHECK(decoded->field_count < full->field_count);
+			validCuts++;
+		}
+		else
+			CHECK(result == TIO_ERROR_PROTOCOL);
+	}
+
+	// command, handle and event in the header, fields after the last one of it
+	CHECK(validCuts == full->field_count - 3);
+
+	//
+	// string size bigger than what's left
+	//
+	pr1_message_reset(decoded);
+	body = Varint(TIO_COMMAND_SET) + Varint(PR2_FIELD_TAG(MESSAGE_FIELD_ID_KEY, MESSAGE_FIELD_TYPE_STRING)) + Varint(0xFFFFFFFF) + "abc";
+	CHECK(Pr2DecodeBody(body, decoded) == TIO_ERROR_PROTOCOL);
+
+	pr1_message_delete(decoded);
+	pr1_message_delete(full);
+	pr1_message_delete(message);
+}
+
+//
+// pr2_encode_message writes to a buffer with the PR1 message size. The worst
+// cases are the ones with the smallest PR1 fields for their PR2 size
+//
+void TestEncodedSizeBound()
+{
+	PR1_MESSAGE* message = pr1_message_new();
+
+	// no fields, so the command is a zero that isn't in the PR1 message
+	Pr2Encode(message);
+
+	pr1_message_add_field(message, 0xFFFF, MESSAGE_FIELD_TYPE_NONE, NULL, 0);
+	pr1_message_add_field_int(message, 0xFFFF, INT_MIN);
+	pr1_message_add_field_double(message, 0xFFFF, -1.0);
+	pr1_message_add_field(message, 0xFFFF, MESSAGE_FIELD_TYPE_STRING, NULL, 0);
+	pr1_message_add_field(message, 0xFFFF, MESSAGE_FIELD_TYPE_STRING, "x", 1);
+
+	// unknown types are sent as strings
+	pr1_message_add_field(message, 0xFFFF, 0x99, "x", 1);
+
+	Pr2Encode(message);
+
+	//
+	// events with no handle and event code fields still have them in the PR2 header
+	//
+	pr1_message_reset(message);
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_EVENT);
+
+	Pr2Encode(message);
+
+	pr1_message_reset(message);
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_COMMAND, -1);
+	pr1_message_add_field(message, 0xFFFF, MESSAGE_FIELD_TYPE_NONE, NULL, 0);
+
+	Pr2Encode(message);
+
+	pr1_message_delete(message);
+}
+
+static string Zlib(const string& data)
+{
+	uLongf size = compressBound(static_cast<uLong>(data.size()));
+	vector<char> output(size);
+
+	CHECK(compress2(reinterpret_cast<Bytef*>(&output[0]), &size, reinterpret_cast<const Bytef*>(data.data()), static_cast<uLong>(data.size()), Z_BEST_SPEED) == Z_OK);
+
+	return string(&output[0], size);
+}
+
+//
+// the size the peer says the data has, followed by the zlib data
+//
+static void AddCompressedField(PR1_MESSAGE* message, unsigned int originalSize, const string& data)
+{
+	string field(sizeof(originalSize), '\0');
+
+	memcpy(&field[0], &originalSize, sizeof(originalSize));
+	field += data;
+
+	pr1_message_add_field(message, MESSAGE_FIELD_ID_VALUE, MESSAGE_FIELD_TYPE_COMPRESSED, field.data(), static_cast<unsigned int>(field.size()));
+}
+
+static int Decompress(PR1_MESSAGE* message, PR1_MESSAGE* output)
+{
+	void* buffer;
+	unsigned int size;
+
+	pr1_message_get_buffer(message, &buffer, &size);
+
+	return pr1_decompress_fields(buffer, output);
+}
+
+//
+// Rejected messages can't have made the output reserve the size they declared
+//
+static const unsigned int MAX_REJECTED_BUFFER_SIZE = 4 * 1024 * 1024;
+
+static void CheckDecompressRejected(PR1_MESSAGE* message)
+{
+	PR1_MESSAGE* output = pr1_message_new();
+
+	CHECK(Decompress(message, output) == TIO_ERROR_PROTOCOL);
+	CHECK(output->stream_buffer->buffer_size < MAX_REJECTED_BUFFER_SIZE);
+
+	pr1_message_delete(output);
+}
+
+void TestCompressionRoundTrip()
+{
+	PR1_MESSAGE* message = pr1_message_new();
+	PR1_MESSAGE* compressed = pr1_message_new();
+	PR1_MESSAGE* decompressed = pr1_message_new();
+
+	string big;
+
+	for(int a = 0 ; big.size() < 100 * 1024 ; a++)
+		big += "record " + std::to_string(a) + ";";
+
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_SET);
+	pr1_message_add_field_string(message, MESSAGE_FIELD_ID_KEY, "small");
+	pr1_message_add_field_string(message, MESSAGE_FIELD_ID_VALUE, big.c_str());
+	pr1_message_add_field_int(message, MESSAGE_FIELD_ID_METADATA, 1);
+
+	void* buffer;
+	unsigned int size;
+
+	pr1_message_get_buffer(message, &buffer, &size);
+
+	CHECK(pr1_compress_fields(buffer, TIO_DEFAULT_COMPRESSION_THRESHOLD, compressed) == 1);
+	CHECK(GetPr1Buffer(compressed).size() < size / 2);
+
+	CHECK(Decompress(compressed, decompressed) == 1);
+	CHECK(GetPr1Buffer(decompressed) == GetPr1Buffer(message));
+
+	//
+	// nothing to decompress, the original message is used
+	//
+	pr1_message_reset(decompressed);
+	CHECK(Decompress(message, decompressed) == 0);
+
+	pr1_message_delete(decompressed);
+	pr1_message_delete(compressed);
+	pr1_message_delete(message);
+}
+
+void TestDeclaredSizeOverLimit()
+{
+	PR1_MESSAGE* message = pr1_message_new();
+
+	//
+	// more than deflate can do with this data
+	//
+	AddCompressedField(message, 0xFFFFFFFF, Zlib("tio"));
+	CheckDecompressRejected(message);
+
+	//
+	// enough data for the ratio, but more than a message can have
+	//
+	pr1_message_reset(message);
+	AddCompressedField(message, PR1_MAX_DECOMPRESSED_SIZE + 1, string(PR1_MAX_DECOMPRESSED_SIZE / PR1_MAX_COMPRESSION_RATIO + 1, 'x'));
+	CheckDecompressRejected(message);
+
+	//
+	// each field is fine, the message isn't
+	//
+	string data(1024 * 1024, 'x');
+
+	pr1_message_reset(message);
+	AddCompressedField(message, static_cast<unsigned int>(data.size()), Zlib(data));
+	AddCompressedField(message, PR1_MAX_DECOMPRESSED_SIZE - static_cast<unsigned int>(data.size()) + 1, 
+		string(PR1_MAX_DECOMPRESSED_SIZE / PR1_MAX_COMPRESSION_RATIO + 1, 'x'));
+	CheckDecompressRejected(message);
+
+	pr1_message_delete(message);
+}
+
+//
+// Data that expands to more than the declared size stops when
+// the declared size is reached
+//
+void TestZlibBomb()
+{
+	PR1_MESSAGE* message = pr1_message_new();
+	string bomb = Zlib(string(64 * 1024 * 1024, '\0'));
+
+	AddCompressedField(message, static_cast<unsigned int>(bomb.size()), bomb);
+	CheckDecompressRejected(message);
+
+	pr1_message_delete(message);
+}
+
+void TestTruncatedStream()
+{
+	PR1_MESSAGE* message = pr1_message_new();
+	string data(100 * 1024, 'x');
+	string compressed = Zlib(data);
+
+	for(size_t size = 0 ; size < compressed.size() ; size++)
+	{
+		pr1_message_reset(message);
+		AddCompressedField(message, static_cast<unsigned int>(data.size()), compressed.substr(0, size));
+		CheckDecompressRejected(message);
+	}
+
+	//
+	// the stream ends before the declared size
+	//
+	pr1_message_reset(message);
+	AddCompressedField(message, static_cast<unsigned int>(data.size()) + 1, compressed);
+	CheckDecompressRejected(message);
+
+	//
+	// not even the size
+	//
+	pr1_message_reset(message);
+	pr1_message_add_field(message, MESSAGE_FIELD_ID_VALUE, MESSAGE_FIELD_TYPE_COMPRESSED, "\x10\x00", 2);
+	CheckDecompressRejected(message);
+
+	//
+	// a field bigger than the message
+	//
+	pr1_message_reset(message);
+	AddCompressedField(message, static_cast<unsigned int>(data.size()), compressed);
+
+	void* buffer;
+	unsigned int size;
+
+	pr1_message_get_buffer(message, &buffer, &size);
+	static_cast<PR1_MESSAGE_HEADER*>(buffer)->message_size--;
+
+	PR1_MESSAGE* output = pr1_message_new();
+	CHECK(pr1_decompress_fields(buffer, output) == TIO_ERROR_PROTOCOL);
+
+	pr1_message_delete(output);
+	pr1_message_delete(message);
+}
+
+int main()
+{
+	TestVarint();
+	TestRoundTrip();
+	TestFiveByteInt();
+	TestTags();
+	TestTruncatedBody();
+	TestEncodedSizeBound();
+	TestCompressionRoundTrip();
+	TestDeclaredSizeOverLimit();
+	TestZlibBomb();
+	TestTruncatedStream();
+
+	cout << "ProtocolCodec: all tests passed" << endl;
+
+	return 0;
+}
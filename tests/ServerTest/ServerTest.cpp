@@ -0,0 +1,502 @@
+/*
+Tio: The Information Overlord
+Copyright 2010 Rodrigo Strauss (http://www.1bit.com.br)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+//
+// Runs a server with owner threads (--owner-threads) in this process and
+// talks to it with the C client, on both binary protocols
+//
+
+#include "pch.h"
+#include "TioTcpServer.h"
+#include "ServerShards.h"
+#include "MemoryStorage.h"
+
+using namespace tio;
+
+using std::cout;
+using std::endl;
+
+#define CHECK(x) \
+	if(!(x)) \
+	{ \
+		cout << __FILE__ << "(" << __LINE__ << "): check failed: " << #x << endl; \
+		exit(1); \
+	}
+
+static const unsigned short TEST_PORT = 2606;
+static const unsigned OWNER_THREAD_COUNT = 4;
+
+//
+// the server, with the same setup tiodb uses
+//
+class TestServer : boost::noncopyable
+{
+	ContainerManager containerManager_;
+	asio::io_service io_service_;
+	unique_ptr<asio::io_service::work> work_;
+	ServerShards shards_;
+	unique_ptr<TioTcpServer> server_;
+	boost::thread thread_;
+
+public:
+	TestServer()
+		: shards_(OWNER_THREAD_COUNT)
+	{
+		shared_ptr<ITioStorageManager> mem = std::make_shared<MemoryStorage::MemoryStorageManager>();
+
+		containerManager_.RegisterFundamentalStorageManagers(mem, mem);
+		containerManager_.RegisterStorageManager("volatile_vector", mem);
+
+		shards_.Start();
+
+		server_.reset(new TioTcpServer(containerManager_, io_service_,
+			tcp::endpoint(tcp::v4(), TEST_PORT), string(), &shards_, 1));
+
+		server_->Start();
+
+		work_.reset(new asio::io_service::work(io_service_));
+		thread_ = boost::thread([this](){ io_service_.run(); });
+	}
+
+	~TestServer()
+	{
+		work_.reset();
+		io_service_.stop();
+		thread_.join();
+		shards_.Stop();
+	}
+};
+
+class Connection : boost::noncopyable
+{
+	TIO_CONNECTION* connection_;
+
+public:
+	explicit Connection(int protocol)
+	{
+		CHECK(!TIO_FAILED(tio_connect_ex("127.0.0.1", TEST_PORT, protocol, &connection_)));
+	}
+
+	~Connection()
+	{
+		tio_disconnect(connection_);
+	}
+
+	operator TIO_CONNECTION*()
+	{
+		return connection_;
+	}
+
+	TIO_CONTAINER* Create(const string& name, const char* type)
+	{
+		TIO_CONTAINER* container;
+
+		CHECK(!TIO_FAILED(tio_create(connection_, name.c_str(), type, &container)));
+
+		return container;
+	}
+};
+
+static void GetQueryItemKey(int result, void* handle, void* cookie, unsigned int queryId,
+	const char* containerName, const TIO_DATA* key, const TIO_DATA* value, const TIO_DATA* metadata)
+{
+	CHECK(key->data_type == TIO_DATA_TYPE_INT);
+
+	*static_cast<int*>(cookie) = key->int_;
+}
+
+//
+// a query for the last record, the key is its index
+//
+static int QueryLastIndex(TIO_CONTAINER* container)
+{
+	int index = -1;
+
+	CHECK(!TIO_FAILED(tio_container_query(container, -1, 0, NULL, GetQueryItemKey, &index)));
+
+	return index;
+}
+
+static void CountErrors(int result, void* handle, void* cookie, unsigned int eventCode,
+	const char* groupName, const char* containerName, const TIO_DATA* key, const TIO_DATA* value, const TIO_DATA* metadata)
+{
+	CHECK(eventCode == TIO_EVENT_ERROR);
+	CHECK(TIO_FAILED(result));
+
+	++*static_cast<int*>(cookie);
+}
+
+//
+// No-reply writes are sent back to back with the commands after them. The
+// containers are spread over the owner threads, so the writes run on other
+// threads while the session keeps reading. They are big enough to be still
+// running when the next command arrives, and nothing sent after a write can
+// be answered without seeing it
+//
+void TestNoReplyPipeline(int protocol)
+{
+	static const int CONTAINER_COUNT = 8;
+	static const int ROUNDS = 20;
+	static const int BATCH_SIZE = 4096;
+
+	Connection connection(protocol);
+	TIO_CONTAINER* containers[CONTAINER_COUNT];
+	int errors = 0;
+
+	for(int a = 0 ; a < CONTAINER_COUNT ; a++)
+		containers[a] = connection.Create("no_reply_" + std::to_string(protocol) + "_" + std::to_string(a), "volatile_list");
+
+	tio_set_no_reply(connection, 1, CountErrors, &errors);
+
+	vector<TIO_DATA> values(BATCH_SIZE);
+
+	for(TIO_DATA& value : values)
+	{
+		tiodata_init(&value);
+		tiodata_set_int(&value, 0);
+	}
+
+	for(int round = 0 ; round < ROUNDS ; round++)
+	{
+		for(int a = 0 ; a < CONTAINER_COUNT ; a++)
+		{
+			TIO_CONTAINER* container = containers[a];
+			TIO_CONTAINER* other = containers[(a + 1) % CONTAINER_COUNT];
+			int count;
+
+			CHECK(!TIO_FAILED(tio_container_push_back_many(container, BATCH_SIZE, NULL, &values[0], NULL)));
+
+			//
+			// a query, that runs on the session, and a data
+			// command for (probably) another owner
+			//
+			CHECK(QueryLastIndex(container) == (round + 1) * BATCH_SIZE - 1);
+
+			CHECK(!TIO_FAILED(tio_container_get_count(other, &count)));
+			CHECK(count == (a + 1 < CONTAINER_COUNT ? round : round + 1) * BATCH_SIZE);
+		}
+	}
+
+	//
+	// open, write and close, without waiting between them
+	//
+	for(int a = 0 ; a < CONTAINER_COUNT ; a++)
+	{
+		TIO_CONTAINER* container;
+
+		CHECK(!TIO_FAILED(tio_open(connection, tio_container_name(containers[a]), NULL, &container)));
+		CHECK(!TIO_FAILED(tio_container_push_back(container, NULL, &values[0], NULL)));
+		CHECK(!TIO_FAILED(tio_close(container)));
+
+		CHECK(QueryLastIndex(containers[a]) == ROUNDS * BATCH_SIZE);
+	}
+
+	tio_dispatch_pending_events(connection, 0xFFFFFFFF);
+	CHECK(errors == 0);
+}
+
+//
+// Errors of no-reply writes still on the wire are reported even after
+// no-reply mode is turned off
+//
+void TestNoReplyErrorAfterTurningOff(int protocol)
+{
+	Connection connection(protocol);
+	int errors = 0, count;
+
+	TIO_CONTAINER* container = connection.Create("no_reply_error_" + std::to_string(protocol), "volatile_list");
+
+	tio_set_no_reply(connection, 1, CountErrors, &errors);
+
+	TIO_DATA key, value;
+	tiodata_init(&key);
+	tiodata_init(&value);
+
+	//
+	// there's no record 10
+	//
+	tiodata_set_int(&key, 10);
+	tiodata_set_int(&value, 1);
+	CHECK(!TIO_FAILED(tio_container_set(container, &key, &value, NULL)));
+
+	tio_set_no_reply(connection, 0, NULL, NULL);
+
+	//
+	// the error event comes before this answer
+	//
+	CHECK(!TIO_FAILED(tio_container_get_count(container, &count)));
+	CHECK(count == 0);
+
+	tio_dispatch_pending_events(connection, 0xFFFFFFFF);
+	CHECK(errors == 1);
+
+	tiodata_set_as_none(&key);
+	tiodata_set_as_none(&value);
+}
+
+//
+// A record starts at a field id that is not bigger than the one before it,
+// so missing fields are fine as long as the order is kept
+//
+void TestPr1MessageGetRecords()
+{
+	shared_ptr<PR1_MESSAGE> message = Pr1CreateMessage();
+
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_SET_MANY);
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_HANDLE, 1);
+
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_KEY, string("k1"));
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_VALUE, 1);
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_METADATA, string("m1"));
+
+	// no metadata, and a field that is not part of the records
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_KEY, string("k2"));
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_REQUEST_ID, 1234);
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_VALUE, 2);
+
+	// value only
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_VALUE, 3);
+
+	// no value
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_KEY, string("k4"));
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_METADATA, string("m4"));
+
+	// metadata only
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_METADATA, string("m5"));
+
+	void* buffer;
+	unsigned int bufferSize;
+
+	pr1_message_get_buffer(message.get(), &buffer, &bufferSize);
+
+	Pr1MessageView view;
+	CHECK(view.Parse(buffer, bufferSize));
+
+	vector<TIO_RECORD> records;
+	Pr1MessageGetRecords(view, &records);
+
+	CHECK(records.size() == 5);
+
+	CHECK(records[0].key == TioData("k1"));
+	CHECK(records[0].value == TioData(1));
+	CHECK(records[0].metadata == TioData("m1"));
+
+	CHECK(records[1].key == TioData("k2"));
+	CHECK(records[1].value == TioData(2));
+	CHECK(records[1].metadata.IsNull());
+
+	CHECK(records[2].key.IsNull());
+	CHECK(records[2].value == TioData(3));
+	CHECK(records[2].metadata.IsNull());
+
+	CHECK(records[3].key == TioData("k4"));
+	CHECK(records[3].value.IsNull());
+	CHECK(records[3].metadata == TioData("m4"));
+
+	CHECK(records[4].key.IsNull());
+	CHECK(records[4].value.IsNull());
+	CHECK(records[4].metadata == TioData("m5"));
+
+	//
+	// no record fields at all
+	//
+	message = Pr1CreateMessage();
+	Pr1MessageAddField(message.get(), MESSAGE_FIELD_ID_COMMAND, TIO_COMMAND_PUSH_BACK_MANY);
+
+	pr1_message_get_buffer(message.get(), &buffer, &bufferSize);
+	CHECK(view.Parse(buffer, bufferSize));
+
+	Pr1MessageGetRecords(view, &records);
+	CHECK(records.empty());
+}
+
+//
+// sends a message the client API can't build and returns the answer error code
+//
+static int SendMessageAndGetResult(TIO_CONNECTION* connection, PR1_MESSAGE* message)
+{
+	PR1_MESSAGE* answer = NULL;
+
+	CHECK(!TIO_FAILED(tio_message_send_and_delete(connection, message)));
+	CHECK(!TIO_FAILED(tio_receive_until_not_event(connection, &answer)));
+
+	int result = pr1_message_get_error_code(answer);
+
+	pr1_message_delete(answer);
+
+	return result;
+}
+
+void TestManyCommands(int protocol)
+{
+	//
+	// more than one message per call, so the client splits them
+	//
+	static const unsigned int RECORD_COUNT = TIO_MAX_RECORDS_PER_MESSAGE * 2 + 3;
+
+	Connection connection(protocol);
+	string suffix = std::to_string(protocol);
+
+	TIO_CONTAINER* list = connection.Create("many_list_" + suffix, "volatile_list");
+	TIO_CONTAINER* map = connection.Create("many_map_" + suffix, "volatile_map");
+
+	vector<TIO_DATA> keys(RECORD_COUNT), values(RECORD_COUNT), metadatas(RECORD_COUNT);
+	vector<string> keyStrings(RECORD_COUNT);
+
+	for(unsigned int a = 0 ; a < RECORD_COUNT ; a++)
+	{
+		keyStrings[a] = "key" + std::to_string(a);
+
+		tiodata_init(&keys[a]);
+		tiodata_init(&values[a]);
+		tiodata_init(&metadatas[a]);
+
+		tiodata_set_string_and_size(&keys[a], keyStrings[a].c_str(), static_cast<unsigned int>(keyStrings[a].size()));
+		tiodata_set_int(&values[a], a);
+
+		//
+		// records without metadata in the middle of the others
+		//
+		if(a % 3)
+			tiodata_set_string_and_size(&metadatas[a], "meta", 4);
+	}
+
+	int count;
+
+	CHECK(!TIO_FAILED(tio_container_push_back_many(list, RECORD_COUNT, NULL, &values[0], &metadatas[0])));
+	CHECK(!TIO_FAILED(tio_container_get_count(list, &count)));
+	CHECK(count == RECORD_COUNT);
+
+	CHECK(!TIO_FAILED(tio_container_set_many(map, RECORD_COUNT, &keys[0], &values[0], &metadatas[0])));
+	CHECK(!TIO_FAILED(tio_container_get_count(map, &count)));
+	CHECK(count == RECORD_COUNT);
+
+	//
+	// every other key is missing, and the answers span three messages
+	//
+	vector<TIO_DATA> searchKeys(RECORD_COUNT), foundKeys(RECORD_COUNT), foundValues(RECORD_COUNT), foundMetadatas(RECORD_COUNT);
+	vector<int> results(RECORD_COUNT);
+	vector<string> searchKeyStrings(RECORD_COUNT);
+
+	for(unsigned int a = 0 ; a < RECORD_COUNT ; a++)
+	{
+		searchKeyStrings[a] = (a % 2 ? "missing" : "key") + std::to_string(a);
+
+		tiodata_init(&searchKeys[a]);
+		tiodata_set_string_and_size(&searchKeys[a], searchKeyStrings[a].c_str(), static_cast<unsigned int>(searchKeyStrings[a].size()));
+	}
+
+	CHECK(!TIO_FAILED(tio_container_get_many(map, RECORD_COUNT, &searchKeys[0], &foundKeys[0], &foundValues[0], &foundMetadatas[0], &results[0])));
+
+	for(unsigned int a = 0 ; a < RECORD_COUNT ; a++)
+	{
+		CHECK(foundKeys[a].data_type == TIO_DATA_TYPE_STRING);
+		CHECK(string(foundKeys[a].string_, foundKeys[a].string_size_) == searchKeyStrings[a]);
+
+		if(a % 2)
+		{
+			CHECK(results[a] == TIO_ERROR_NO_SUCH_OBJECT);
+			CHECK(foundValues[a].data_type == TIO_DATA_TYPE_NONE);
+			CHECK(foundMetadatas[a].data_type == TIO_DATA_TYPE_NONE);
+		}
+		else
+		{
+			CHECK(results[a] == TIO_SUCCESS);
+			CHECK(foundValues[a].data_type == TIO_DATA_TYPE_INT);
+			CHECK(foundValues[a].int_ == static_cast<int>(a));
+			CHECK(foundMetadatas[a].data_type == (a % 3 ? TIO_DATA_TYPE_STRING : TIO_DATA_TYPE_NONE));
+		}
+
+		tiodata_set_as_none(&searchKeys[a]);
+		tiodata_set_as_none(&foundKeys[a]);
+		tiodata_set_as_none(&foundValues[a]);
+		tiodata_set_as_none(&foundMetadatas[a]);
+	}
+
+	//
+	// the second record has no key. The first one stays applied
+	//
+	TIO_DATA badKeys[2], badValues[2];
+
+	tiodata_init(&badKeys[0]);
+	tiodata_init(&badKeys[1]);
+	tiodata_init(&badValues[0]);
+	tiodata_init(&badValues[1]);
+	tiodata_set_string_and_size(&badKeys[0], "applied", 7);
+	tiodata_set_int(&badValues[0], 1);
+	tiodata_set_int(&badValues[1], 2);
+
+	CHECK(TIO_FAILED(tio_container_set_many(map, 2, badKeys, badValues, NULL)));
+	CHECK(!TIO_FAILED(tio_container_get_count(map, &count)));
+	CHECK(count == RECORD_COUNT + 1);
+
+	tiodata_set_as_none(&badKeys[0]);
+
+	//
+	// more records than the limit in a single message. Nothing is applied
+	//
+	TIO_CONTAINER* containers[] = { list, map, map };
+	unsigned int commands[] = { TIO_COMMAND_PUSH_BACK_MANY, TIO_COMMAND_SET_MANY, TIO_COMMAND_GET_MANY };
+
+	for(int a = 0 ; a < 3 ; a++)
+	{
+		int countBefore, countAfter;
+
+		CHECK(!TIO_FAILED(tio_container_get_count(containers[a], &countBefore)));
+
+		PR1_MESSAGE* message = tio_generate_many_message(
+			commands[a], 
+			containers[a]->handle, 
+			TIO_MAX_RECORDS_PER_MESSAGE + 1, 
+			commands[a] == TIO_COMMAND_PUSH_BACK_MANY ? NULL : &keys[0],
+			commands[a] == TIO_COMMAND_GET_MANY ? NULL : &values[0],
+			NULL);
+
+		CHECK(SendMessageAndGetResult(connection, message) != TIO_SUCCESS);
+
+		CHECK(!TIO_FAILED(tio_container_get_count(containers[a], &countAfter)));
+		CHECK(countAfter == countBefore);
+	}
+
+	for(unsigned int a = 0 ; a < RECORD_COUNT ; a++)
+	{
+		tiodata_set_as_none(&keys[a]);
+		tiodata_set_as_none(&metadatas[a]);
+	}
+}
+
+int main()
+{
+	tio_initialize();
+
+	TestPr1MessageGetRecords();
+
+	TestServer server;
+
+	int protocols[] = { TIO_PROTOCOL_BINARY, TIO_PROTOCOL_COMPACT };
+
+	for(int protocol : protocols)
+	{
+		TestNoReplyPipeline(protocol);
+		TestNoReplyErrorAfterTurningOff(protocol);
+		TestManyCommands(protocol);
+	}
+
+	cout << "ServerTest: all tests passed" << endl;
+
+	return 0;
+}
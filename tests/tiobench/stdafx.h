@@ -1,9 +1,12 @@
 #pragma once
 
+#ifdef _WIN32
 #include "targetver.h"
+#include <tchar.h>
+#endif
 
 #include <stdio.h>
-#include <tchar.h>
+#include <assert.h>
 
 #include <memory>
 #include <thread>
@@ -11,7 +14,10 @@
 #include <vector>
 #include <map>
 #include <unordered_map>
+#include <string>
 
 #include <iostream>
 
 #include <chrono>
+
+#include <boost/noncopyable.hpp>
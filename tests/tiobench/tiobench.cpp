@@ -126,6 +126,65 @@ int map_perf_test_c(TIO_CONNECTION* cn, TIO_CONTAINER* container, unsigned opera
 }
 
 
+//
+// keys used by the read tests. The map is filled once by fill_map_c and
+// every reader just does gets, so they can run in parallel on the server
+//
+const unsigned READ_TEST_KEY_COUNT = 1000;
+
+int fill_map_c(TIO_CONNECTION* cn, TIO_CONTAINER* container, unsigned key_count)
+{
+	int ret;
+	TIO_DATA k, v;
+
+	ret = tio_container_clear(container);
+	if(TIO_FAILED(ret)) return ret;
+
+	tiodata_init(&k);
+	tiodata_init(&v);
+	tiodata_set_string_and_size(&v, "01234567890123456789012345678901", 32);
+
+	tio_begin_network_batch(cn);
+
+	for(unsigned a = 0 ; a < key_count ; ++a)
+	{
+		string key = "key_" + to_string(a);
+		tiodata_set_string_and_size(&k, key.c_str(), key.size());
+		tio_container_set(container, &k, &v, NULL);
+	}
+
+	tio_finish_network_batch(cn);
+
+	tiodata_free(&k);
+	tiodata_free(&v);
+
+	return 0;
+}
+
+int map_read_perf_test_c(TIO_CONNECTION* cn, TIO_CONTAINER* container, unsigned operations)
+{
+	int ret = 0;
+	TIO_DATA k, v;
+
+	tiodata_init(&k);
+	tiodata_init(&v);
+
+	for(unsigned a = 0 ; a < operations ; ++a)
+	{
+		string key = "key_" + to_string(a % READ_TEST_KEY_COUNT);
+		tiodata_set_string_and_size(&k, key.c_str(), key.size());
+
+		ret = tio_container_get(container, &k, NULL, &v, NULL);
+		if(TIO_FAILED(ret)) break;
+	}
+
+	tiodata_free(&k);
+	tiodata_free(&v);
+
+	return ret;
+}
+
+
 typedef int(*PERF_FUNCTION_C)(TIO_CONNECTION*, TIO_CONTAINER *, unsigned int);
 
 
@@ -134,13 +193,17 @@ int measure(TIO_CONNECTION* cn, TIO_CONTAINER* container, unsigned test_count,
 {
 	int ret;
 
-	DWORD start = GetTickCount();
+	auto start = std::chrono::steady_clock::now();
 
 	ret = perf_function(cn, container, test_count);
 	if(TIO_FAILED(ret)) return ret;
 
-	DWORD delta = GetTickCount() - start;
-	*persec = (test_count * 1000) / delta;
+	auto delta = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	if(delta == 0)
+		delta = 1;
+
+	*persec = static_cast<unsigned>((test_count * 1000ull) / delta);
 
 	return ret;
 }
@@ -222,7 +285,7 @@ public:
 
 	void clear()
 	{
-		thread_.swap(thread());
+		thread().swap(thread_);
 		container_names_.clear();
 	}
 
@@ -287,6 +350,44 @@ public:
 	}
 };
 
+//
+// Like TioStressTest, but opens an existing container and doesn't
+// clear it after running, since other readers are still using it
+//
+class TioReadStressTest
+{
+	string host_name_;
+	string container_name_;
+	PERF_FUNCTION_C perf_function_;
+	unsigned test_count_;
+	unsigned* persec_;
+public:
+
+	TioReadStressTest(
+		const string& host_name,
+		const string& container_name,
+		PERF_FUNCTION_C perf_function,
+		unsigned test_count,
+		unsigned* persec)
+		: host_name_(host_name)
+		, container_name_(container_name)
+		, perf_function_(perf_function)
+		, test_count_(test_count)
+		, persec_(persec)
+	{
+
+	}
+
+	void operator()()
+	{
+		tio::Connection connection(host_name_);
+		tio::containers::map<string, string> container;
+		container.open(&connection, container_name_);
+
+		measure(connection.cnptr(), container.handle(), test_count_, perf_function_, persec_);
+	}
+};
+
 string generate_container_name()
 {
 	static unsigned seq = 0;
@@ -296,20 +397,30 @@ string generate_container_name()
 }
 
 
-int main()
+//
+// tiobench [write|read|connections] runs just that group of tests
+//
+int main(int argc, char* argv[])
 {
+	string group = argc > 1 ? argv[1] : "";
+
+	bool run_writes = group.empty() || group == "write";
+	bool run_reads = group.empty() || group == "read";
+	bool run_connections = group.empty() || group == "connections";
 
 #ifdef _DEBUG
 	unsigned VOLATILE_TEST_COUNT = 5 * 1000;
 	unsigned PERSISTEN_TEST_COUNT = 5 * 1000;
 	unsigned MAX_CLIENTS = 1024;
 	unsigned MAX_SUBSCRIBERS = 64;
+	unsigned READ_TEST_COUNT = 5 * 1000;
 
 #else
 	unsigned VOLATILE_TEST_COUNT = 100 * 1000;
 	unsigned PERSISTEN_TEST_COUNT = 10 * 1000;
 	unsigned MAX_CLIENTS = 512;
 	unsigned MAX_SUBSCRIBERS = 64;
+	unsigned READ_TEST_COUNT = 20 * 1000;
 #endif
 
 
@@ -319,6 +430,7 @@ int main()
 	int baseline = 0;
 
 
+	if(run_writes)
 	{
 		string test_description = "single volatile list, one client";
 		unsigned persec;
@@ -340,7 +452,7 @@ int main()
 	}
 
 
-	for(unsigned client_count = 1; client_count <= MAX_CLIENTS; client_count *= 2)
+	for(unsigned client_count = 1; run_writes && client_count <= MAX_CLIENTS; client_count *= 2)
 	{
 		for(unsigned subscriber_count = 1; subscriber_count <= MAX_SUBSCRIBERS; subscriber_count *= 2)
 		{
@@ -404,7 +516,7 @@ int main()
 	}
 
 
-	for(int client_count = 1; client_count <= 1024; client_count *= 2)
+	for(int client_count = 1; run_writes && client_count <= 1024; client_count *= 2)
 	{
 		string test_description = "multiple volatile lists, client count=" + to_string(client_count);
 
@@ -438,9 +550,62 @@ int main()
 	}
 
 
+	//
+	// READ SCALING TEST. Start the server with --threads to see the
+	// readers running in parallel
+	//
+	if(run_reads)
+	{
+		string container_name = generate_container_name();
+		string container_type = "volatile_map";
+
+		tio::Connection connection(hostname);
+		tio::containers::map<string, string> container;
+		container.create(&connection, container_name, container_type);
+
+		fill_map_c(connection.cnptr(), container.handle(), READ_TEST_KEY_COUNT);
+
+		unsigned single_reader = 0;
+
+		for(unsigned reader_count = 1; reader_count <= 64; reader_count *= 2)
+		{
+			string test_description = "hot volatile map, readers=" + to_string(reader_count);
+
+			vector<unsigned> persec(reader_count);
+
+			for(unsigned a = 0; a < reader_count; a++)
+			{
+				runner.add_test(
+					TioReadStressTest(
+					hostname,
+					container_name,
+					&map_read_perf_test_c,
+					READ_TEST_COUNT,
+					&persec[a]));
+			}
+
+			runner.run();
+
+			unsigned total = 0;
+
+			for(unsigned p : persec)
+				total += p;
+
+			if(reader_count == 1)
+				single_reader = total;
+
+			cout << test_description << ": total " << total << " gets/sec"
+				 << ", scaling=" << (float)total / single_reader << "x" << endl;
+		}
+
+		container.clear();
+	}
+
+
 	//
 	// CONNECTIONS TEST
 	//
+	if(run_connections)
 	{
 		vector<unique_ptr<tio::Connection>> connections;
 		unsigned log_step = 100;